@@ -0,0 +1,556 @@
+/*******************************************************************************************
+ *
+ *  CATmask concatenates the block tracks of a DB produced by TANmask, REPmask, UNIONmask, or
+ *    any other command that writes a track per block, into a single track for the entire DB.
+ *    The blocks are processed in parallel: the position of each block's anno entries and data
+ *    in the DB track is given by prefix sums over the blocks, each thread rebases and writes
+ *    the anno entries of its blocks directly into place, and the .data files are joined with
+ *    copy_file_range so that the file system can share or clone the blocks rather than copy.
+ *
+ *  Author:  agent
+ *  Date  :  October 18, 2026
+ *
+ *******************************************************************************************/
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "DB.h"
+
+#define THREAD    pthread_t
+
+#ifdef HIDE_FILES
+#define PATHSEP "/."
+#else
+#define PATHSEP "/"
+#endif
+
+static char *Usage = "[-vfd] [-T<int(4)>] <path:db|dam> <track:name> ...";
+
+
+//  Global Data Structures
+
+static int VERBOSE;
+static int NTHREADS;
+
+static int    AFILE, DFILE;     //  File descriptors of the DB track's .anno and .data files
+static int    SIZE;             //  Size of an anno entry (4 or 8)
+static int    HSIZE;            //    as recorded in the block headers (0 means 8)
+static int    HASDATA;          //  Do the blocks have .data files?
+
+  //  The place of each block in the DB track: its anno entries go at byte aoff of the .anno
+  //    file and its data, dlen bytes, at byte doff of the .data file.  Its extras begin at
+  //    byte xoff of its own .anno file.
+
+typedef struct
+  { char  *aname;
+    char  *dname;
+    int    nreads;
+    int64  aoff;
+    int64  doff, dlen;
+    int64  xoff;
+  } Block;
+
+static int    NBLOCKS;
+static Block *BLOCKS;
+
+  //  Each thread handles blocks tid, tid+NTHREADS, ..., and a failure is reported in 'error'
+
+typedef struct
+  { int    tid;
+    int    error;
+    void  *buf;
+  } Cat_Arg;
+
+#define ANNO_CHUNK  0x10000     //  # of anno entries read and rebased at a time
+#define COPY_CHUNK  0x1000000   //  # of bytes per read/write when copy_file_range cannot be used
+
+  //  Copy len bytes of file fin to file fout at offset off, with copy_file_range if possible
+  //    and otherwise by reading and writing through buf.
+
+static int copy_data(int fin, int fout, int64 off, int64 len, void *buf)
+{ int64 in, n;
+
+  in = 0;
+#ifdef __linux__
+  while (len > 0)
+    { loff_t x = in, y = off;
+
+      n = copy_file_range(fin,&x,fout,&y,len,0);
+      if (n <= 0)
+        break;
+      in  += n;
+      off += n;
+      len -= n;
+    }
+#endif
+  while (len > 0)
+    { n = len;
+      if (n > COPY_CHUNK)
+        n = COPY_CHUNK;
+      n = pread(fin,buf,n,in);
+      if (n <= 0)
+        return (1);
+      if (pwrite(fout,buf,n,off) != n)
+        return (1);
+      in  += n;
+      off += n;
+      len -= n;
+    }
+  return (0);
+}
+
+  //  Rebase the anno entries of a block by its data offset and write them in place, then
+  //    copy its data into place.
+
+static int cat_block(Block *b, void *buf)
+{ int    fin;
+  int64  off, m;
+  int    i, n;
+
+  fin = open(b->aname,O_RDONLY);
+  if (fin < 0)
+    return (1);
+  off = 2*sizeof(int);
+  for (i = 0; i < b->nreads; i += n)
+    { n = b->nreads-i;
+      if (n > ANNO_CHUNK)
+        n = ANNO_CHUNK;
+      m = ((int64) n)*SIZE;
+      if (pread(fin,buf,m,off + ((int64) i)*SIZE) != m)
+        { close(fin);
+          return (1);
+        }
+      if (HASDATA)
+        { int k;
+
+          if (SIZE == 4)
+            for (k = 0; k < n; k++)
+              ((int *) buf)[k] += b->doff;
+          else
+            for (k = 0; k < n; k++)
+              ((int64 *) buf)[k] += b->doff;
+        }
+      if (pwrite(AFILE,buf,m,b->aoff + ((int64) i)*SIZE) != m)
+        { close(fin);
+          return (1);
+        }
+    }
+  close(fin);
+
+  if (HASDATA && b->dlen > 0)
+    { fin = open(b->dname,O_RDONLY);
+      if (fin < 0)
+        return (1);
+      if (copy_data(fin,DFILE,b->doff,b->dlen,buf))
+        { close(fin);
+          return (1);
+        }
+      close(fin);
+    }
+  return (0);
+}
+
+static void *cat_thread(void *arg)
+{ Cat_Arg *parm = (Cat_Arg *) arg;
+  int      i;
+
+  for (i = parm->tid; i < NBLOCKS; i += NTHREADS)
+    if (cat_block(BLOCKS+i,parm->buf))
+      { parm->error = i+1;
+        break;
+      }
+  return (NULL);
+}
+
+  //  Gather the block tracks of 'track' and compute their place in the DB track
+
+static int64 gather_blocks(char *pwd, char *root, char *track)
+{ FILE  *afile;
+  int    tracklen, size;
+  int64  nreads, dtot;
+  int    i;
+  char   ans[strlen(track)+7];
+  char   dts[strlen(track)+7];
+
+  strcpy(ans,Catenate(".",track,".","anno"));
+  strcpy(dts,Catenate(".",track,".","data"));
+
+  for (NBLOCKS = 0; 1; NBLOCKS++)
+    { afile = fopen(Catenate(pwd,PATHSEP,root,
+                             Numbered_Suffix(".",NBLOCKS+1,ans)),"r");
+      if (afile == NULL)
+        break;
+      fclose(afile);
+    }
+  if (NBLOCKS == 0)
+    { fprintf(stderr,"%s: There are no block tracks for %s\n",Prog_Name,track);
+      exit (1);
+    }
+
+  BLOCKS = (Block *) Malloc(sizeof(Block)*NBLOCKS,"Allocating block records");
+  if (BLOCKS == NULL)
+    exit (1);
+
+  nreads = 0;
+  dtot   = 0;
+  for (i = 0; i < NBLOCKS; i++)
+    { Block *b = BLOCKS+i;
+      int64  last;
+
+      b->aname = Strdup(Catenate(pwd,PATHSEP,root,Numbered_Suffix(".",i+1,ans)),
+                        "Allocating block name");
+      b->dname = Strdup(Catenate(pwd,PATHSEP,root,Numbered_Suffix(".",i+1,dts)),
+                        "Allocating block name");
+      if (b->aname == NULL || b->dname == NULL)
+        exit (1);
+
+      afile = Fopen(b->aname,"r");
+      if (afile == NULL)
+        exit (1);
+      if (fread(&tracklen,sizeof(int),1,afile) != 1 || fread(&size,sizeof(int),1,afile) != 1)
+        { fprintf(stderr,"%s: Track file %s is junk\n",Prog_Name,b->aname);
+          exit (1);
+        }
+
+      if (i == 0)
+        { HASDATA = (access(b->dname,F_OK) == 0);
+          SIZE    = size;
+        }
+      else if (size != SIZE || HASDATA != (access(b->dname,F_OK) == 0))
+        { fprintf(stderr,"%s: Track file %s is not of the same type as the first block\n",
+                         Prog_Name,b->aname);
+          exit (1);
+        }
+      if (size == 0)
+        size = 8;
+
+      b->nreads = tracklen;
+      b->aoff   = 2*sizeof(int) + nreads*size;
+      b->doff   = dtot;
+      b->dlen   = 0;
+      b->xoff   = 2*sizeof(int) + ((int64) tracklen)*size;
+
+      if (HASDATA)
+        { struct stat info;
+
+          last = 0;
+          if (fseeko(afile,((int64) tracklen)*size,SEEK_CUR) < 0
+                 || fread(&last,size,1,afile) != 1)
+            { fprintf(stderr,"%s: Track file %s is junk\n",Prog_Name,b->aname);
+              exit (1);
+            }
+          if (size == 4)
+            last = *((int *) &last);
+          if (stat(b->dname,&info) < 0 || info.st_size < last)
+            { fprintf(stderr,"%s: Track file %s is truncated\n",Prog_Name,b->dname);
+              exit (1);
+            }
+          b->dlen  = last;
+          b->xoff += size;
+          dtot    += last;
+          if (size == 4 && dtot > INT32_MAX)
+            { fprintf(stderr,"%s: Data of track %s is too large for 4-byte anno entries\n",
+                             Prog_Name,track);
+              exit (1);
+            }
+        }
+
+      fclose(afile);
+      nreads += tracklen;
+    }
+
+  HSIZE = SIZE;
+  if (SIZE == 0)
+    SIZE = 8;
+  return (nreads);
+}
+
+  //  Fold the extras of the block tracks into 'extras' and return their number
+
+static int fold_extras(DAZZ_EXTRA **extras)
+{ DAZZ_EXTRA *ex;
+  int         emax, nex, k;
+  FILE       *afile;
+  int         i, r;
+
+  ex   = NULL;
+  emax = nex = 0;
+  for (i = 0; i < NBLOCKS; i++)
+    { afile = Fopen(BLOCKS[i].aname,"r");
+      if (afile == NULL)
+        exit (1);
+      fseeko(afile,BLOCKS[i].xoff,SEEK_SET);
+      for (k = 0; 1; k++)
+        { if (k >= emax)
+            { emax = 1.2*k + 10;
+              ex   = (DAZZ_EXTRA *) Realloc(ex,sizeof(DAZZ_EXTRA)*emax,"Allocating extras");
+              if (ex == NULL)
+                exit (1);
+            }
+          if (k >= nex)
+            ex[k].nelem = 0;
+          r = Read_Extra(afile,BLOCKS[i].aname,ex+k);
+          if (r < 0)
+            exit (1);
+          if (r > 0)
+            break;
+          if (i > 0 && k >= nex)
+            { fprintf(stderr,"%s: Track file %s has more extras than the first block\n",
+                             Prog_Name,BLOCKS[i].aname);
+              exit (1);
+            }
+        }
+      if (i == 0)
+        nex = k;
+      else if (k != nex)
+        { fprintf(stderr,"%s: Track file %s has fewer extras than the first block\n",
+                         Prog_Name,BLOCKS[i].aname);
+          exit (1);
+        }
+      fclose(afile);
+    }
+
+  *extras = ex;
+  return (nex);
+}
+
+int main(int argc, char *argv[])
+{ char *pwd, *root;
+  int   FORCE, DELETE;
+  int   ureads, treads;
+  int   c;
+
+  //  Process arguments
+
+  { int  i, j, k;
+    int  flags[128];
+    char *eptr;
+
+    ARG_INIT("CATmask")
+
+    NTHREADS = 4;
+
+    j = 1;
+    for (i = 1; i < argc; i++)
+      if (argv[i][0] == '-')
+        switch (argv[i][1])
+        { default:
+            ARG_FLAGS("vfd")
+            break;
+          case 'T':
+            ARG_POSITIVE(NTHREADS,"Number of threads")
+            break;
+        }
+      else
+        argv[j++] = argv[i];
+    argc = j;
+
+    VERBOSE = flags['v'];
+    FORCE   = flags['f'];
+    DELETE  = flags['d'];
+
+    if (argc < 3)
+      { fprintf(stderr,"Usage: %s %s\n",Prog_Name,Usage);
+        fprintf(stderr,"\n");
+        fprintf(stderr,"      -v: Verbose mode, output statistics as proceed.\n");
+        fprintf(stderr,"      -f: Force the overwrite of an existing DB track.\n");
+        fprintf(stderr,"      -d: Delete the block tracks once they are concatenated.\n");
+        fprintf(stderr,"      -T: use -T threads.\n");
+        exit (1);
+      }
+  }
+
+  //  Get the untrimmed and trimmed # of reads of the DB from the header of its index
+
+  { DAZZ_DB db;
+    FILE   *dbfile;
+    int     plen;
+
+    pwd  = PathTo(argv[1]);
+    plen = strlen(argv[1]);
+    if (plen > 4 && strcmp(argv[1]+(plen-4),".dam") == 0)
+      root = Root(argv[1],".dam");
+    else
+      root = Root(argv[1],".db");
+
+    dbfile = fopen(Catenate(pwd,PATHSEP,root,".idx"),"r");
+    if (dbfile == NULL)
+      { fprintf(stderr,"%s: Could not open %s as a DB or a DAM\n",Prog_Name,argv[1]);
+        exit (1);
+      }
+    if (fread(&db,sizeof(DAZZ_DB),1,dbfile) != 1)
+      { fprintf(stderr,"%s: Index file (.idx) of %s is junk\n",Prog_Name,argv[1]);
+        exit (1);
+      }
+    fclose(dbfile);
+    ureads = db.ureads;
+    treads = db.treads;
+  }
+
+  //  Concatenate the block tracks of each named track
+
+  for (c = 2; c < argc; c++)
+    { char       *track = argv[c];
+      int64       nreads, dtot;
+      DAZZ_EXTRA *extras;
+      int         nex;
+      FILE       *afile;
+      char       *name;
+      char        ans[strlen(track)+7];
+      char        dts[strlen(track)+7];
+
+      nreads = gather_blocks(pwd,root,track);
+      if (nreads != ureads && nreads != treads)
+        { fprintf(stderr,"%s: Block tracks of %s do not cover the DB %s\n",
+                         Prog_Name,track,argv[1]);
+          exit (1);
+        }
+      nex = fold_extras(&extras);
+
+      strcpy(ans,Catenate(".",track,".","anno"));
+      strcpy(dts,Catenate(".",track,".","data"));
+      name = Catenate(pwd,PATHSEP,root,ans);
+      if ( ! FORCE && access(name,F_OK) == 0)
+        { fprintf(stderr,"%s: Track file %s already exists, use -f to overwrite\n",
+                         Prog_Name,name);
+          exit (1);
+        }
+
+      if (VERBOSE)
+        { printf("Concatenating %d blocks of track %s: ",NBLOCKS,track);
+          Print_Number(nreads,0,stdout);
+          printf(" reads");
+          fflush(stdout);
+        }
+
+      afile = Fopen(name,"w");
+      if (afile == NULL)
+        exit (1);
+      AFILE = fileno(afile);
+      DFILE = -1;
+      if (HASDATA)
+        { DFILE = open(Catenate(pwd,PATHSEP,root,dts),
+                       O_WRONLY | O_CREAT | O_TRUNC,0666);
+          if (DFILE < 0)
+            { fprintf(stderr,"%s: Cannot open data file of track %s for writing\n",
+                             Prog_Name,track);
+              exit (1);
+            }
+        }
+
+      { int len = nreads;
+
+        if (pwrite(AFILE,&len,sizeof(int),0) != sizeof(int)
+               || pwrite(AFILE,&HSIZE,sizeof(int),sizeof(int)) != sizeof(int))
+          { fprintf(stderr,"%s: Write of track %s failed\n",Prog_Name,track);
+            exit (1);
+          }
+      }
+
+      //  Rebase and place the anno entries and data of the blocks with NTHREADS threads
+
+      { THREAD  threads[NTHREADS];
+        Cat_Arg parm[NTHREADS];
+        int     i;
+
+        for (i = 0; i < NTHREADS; i++)
+          { parm[i].tid   = i;
+            parm[i].error = 0;
+            parm[i].buf   = Malloc(COPY_CHUNK,"Allocating copy buffer");
+            if (parm[i].buf == NULL)
+              exit (1);
+          }
+
+        for (i = 0; i < NTHREADS; i++)
+          pthread_create(threads+i,NULL,cat_thread,parm+i);
+        for (i = 0; i < NTHREADS; i++)
+          pthread_join(threads[i],NULL);
+
+        for (i = 0; i < NTHREADS; i++)
+          { free(parm[i].buf);
+            if (parm[i].error)
+              { fprintf(stderr,"%s: Concatenation of %s failed\n",
+                               Prog_Name,BLOCKS[parm[i].error-1].aname);
+                exit (1);
+              }
+          }
+      }
+
+      //  Write the final anno entry and the folded extras, and only if all of the track
+      //    reached the disk are the block tracks deleted below
+
+      dtot = 0;
+      if (NBLOCKS > 0)
+        dtot = BLOCKS[NBLOCKS-1].doff + BLOCKS[NBLOCKS-1].dlen;
+
+      { int error, k;
+
+        error = (fseeko(afile,2*sizeof(int) + nreads*SIZE,SEEK_SET) < 0);
+        if (HASDATA && ! error)
+          { if (SIZE == 4)
+              { int d = dtot;
+                error = (fwrite(&d,sizeof(int),1,afile) != 1);
+              }
+            else
+              error = (fwrite(&dtot,sizeof(int64),1,afile) != 1);
+          }
+
+        for (k = 0; k < nex; k++)
+          { if ( ! error)
+              error = Write_Extra(afile,extras+k);
+            free(extras[k].name);
+            free(extras[k].value);
+          }
+        free(extras);
+
+        if (fclose(afile) != 0)
+          error = 1;
+        if (HASDATA && close(DFILE) < 0)
+          error = 1;
+        if (error)
+          { fprintf(stderr,"%s: Write of track %s failed\n",Prog_Name,track);
+            exit (1);
+          }
+      }
+
+      if (VERBOSE)
+        { if (HASDATA)
+            { printf(", ");
+              Print_Number(dtot,0,stdout);
+              printf(" bytes of data");
+            }
+          printf("\n");
+        }
+
+      { int i;
+
+        for (i = 0; i < NBLOCKS; i++)
+          { if (DELETE)
+              { unlink(BLOCKS[i].aname);
+                if (HASDATA)
+                  unlink(BLOCKS[i].dname);
+              }
+            free(BLOCKS[i].aname);
+            free(BLOCKS[i].dname);
+          }
+        free(BLOCKS);
+      }
+    }
+
+  free(pwd);
+  free(root);
+  free(Prog_Name);
+
+  exit (0);
+}
@@ -18,7 +18,14 @@
 #include <unistd.h>
 #include <dirent.h>
 #include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#ifdef DB_THREADS
+#include <pthread.h>
+#endif
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
 
 #include "DB.h"
 
@@ -337,31 +344,47 @@ void Compress_Read(int len, char *s)
   s2[len] = d;
 }
 
-//  Uncompress read form 2-bits per base into [0-3] per byte representation
+//  Uncompress read form 2-bits per base into [0-3] per byte representation.  Each byte is
+//    expanded with a table of its 4 bases, working from the last byte back so that it can
+//    be done in place.  Nothing beyond s[len] is touched.
 
-void Uncompress_Read(int len, char *s)
-{ int   i, tlen, byte;
-  char *s0, *s1, *s2, *s3;
-  char *t;
+#define U4(b)   { ((b)>>6)&0x3, ((b)>>4)&0x3, ((b)>>2)&0x3, (b)&0x3 }
+#define U16(b)  U4(b),    U4(b+1),  U4(b+2),  U4(b+3),  U4(b+4),  U4(b+5),  U4(b+6),  U4(b+7), \
+                U4(b+8),  U4(b+9),  U4(b+10), U4(b+11), U4(b+12), U4(b+13), U4(b+14), U4(b+15)
+#define U64(b)  U16(b), U16(b+16), U16(b+32), U16(b+48)
 
-  s0 = s;
-  s1 = s0+1;
-  s2 = s1+1;
-  s3 = s2+1;
+static const char Unpack[256][4] = { U64(0), U64(64), U64(128), U64(192) };
 
-  tlen = (len-1)/4;
+void Uncompress_Read(int len, char *s)
+{ uint8 *t = (uint8 *) s;
+  int    i, k, tlen, byte;
 
-  t = s+tlen;
-  for (i = tlen*4; i >= 0; i -= 4)
-    { byte = *t--;
-      s0[i] = (char) ((byte >> 6) & 0x3);
-      s1[i] = (char) ((byte >> 4) & 0x3);
-      s2[i] = (char) ((byte >> 2) & 0x3);
-      s3[i] = (char) (byte & 0x3);
+  if (len > 0)
+    { tlen = (len-1)/4;
+      byte = t[tlen];
+      for (k = len-4*tlen-1; k >= 0; k--)
+        s[4*tlen+k] = Unpack[byte][k];
+      for (i = tlen-1; i >= 0; i--)
+        memcpy(s+4*i,Unpack[t[i]],4);
     }
   s[len] = 4;
 }
 
+//  Uncompress bases [beg,end) of the 2-bit compressed read s into t[0..end-beg), leaving s as is
+
+static void Unpack_Bases(uint8 *s, int beg, int end, char *t)
+{ int i;
+
+  for (i = beg; i < end && (i & 0x3) != 0; i++)
+    *t++ = Unpack[s[i>>2]][i&0x3];
+  for ( ; i+4 <= end; i += 4)
+    { memcpy(t,Unpack[s[i>>2]],4);
+      t += 4;
+    }
+  for ( ; i < end; i++)
+    *t++ = Unpack[s[i>>2]][i&0x3];
+}
+
 //  Convert read in [0-3] representation to ascii representation (end with '\n')
 
 void Lower_Read(char *s)
@@ -901,6 +924,73 @@ error:
 }
 
 
+  //  The reads kept by trimming the untrimmed reads [ufirst,ufirst+ureads) of a DB are recorded
+  //    in a bit vector when it is trimmed, so that a track opened after the trim (see
+  //    Late_Track_Trim) need not reread the index.  Only the vector of the DB last trimmed is
+  //    kept, and it is identified by the DB record, path, block, and trim settings.
+
+static DAZZ_DB *Keep_DB = NULL;      //  DB of Keep_Bits (NULL if none)
+static char    *Keep_Path = NULL;
+static int      Keep_First, Keep_Reads, Keep_Cutoff, Keep_All;
+static uint64  *Keep_Bits = NULL;
+
+#define KEPT(bits,i)  (((bits)[(i)>>6] >> ((i)&0x3f)) & 0x1)
+
+#define IDX_CHUNK  0x10000     //  # of read records read from the .idx file at a time
+
+  //  Set the bits of Keep_Bits for the reads of block reads[0..ureads) kept by trimming,
+  //    reading the records from the file indx if reads is NULL.
+
+static uint64 *keep_bits(DAZZ_DB *db, DAZZ_READ *reads, FILE *indx, int ureads,
+                         int allflag, int cutoff)
+{ DAZZ_READ *buf;
+  uint64    *bits;
+  int        i, k, n;
+
+  bits = (uint64 *) Realloc(Keep_Bits,sizeof(uint64)*((ureads>>6)+1),"Allocating trim vector");
+  if (bits == NULL)
+    return (NULL);
+  Keep_Bits = bits;
+  Keep_DB   = NULL;
+  memset(bits,0,sizeof(uint64)*((ureads>>6)+1));
+
+  buf = NULL;
+  if (reads == NULL)
+    { buf = (DAZZ_READ *) Malloc(sizeof(DAZZ_READ)*IDX_CHUNK,"Allocating index buffer");
+      if (buf == NULL)
+        return (NULL);
+    }
+
+  for (i = 0; i < ureads; i += n)
+    { n = ureads-i;
+      if (buf != NULL)
+        { if (n > IDX_CHUNK)
+            n = IDX_CHUNK;
+          if (fread(buf,sizeof(DAZZ_READ),n,indx) != (size_t) n)
+            { EPRINTF(EPLACE,"%s: Index file (.idx) of %s is junk\n",Prog_Name,db->path);
+              free(buf);
+              return (NULL);
+            }
+          reads = buf - i;
+        }
+      for (k = i; k < i+n; k++)
+        if ((reads[k].flags & DB_BEST) >= allflag && reads[k].rlen >= cutoff)
+          bits[k>>6] |= (1llu << (k&0x3f));
+    }
+  free(buf);
+
+  free(Keep_Path);
+  Keep_Path = Strdup(db->path,"Allocating trim vector");
+  if (Keep_Path == NULL)
+    return (NULL);
+  Keep_DB     = db;
+  Keep_First  = db->ufirst;
+  Keep_Reads  = ureads;
+  Keep_Cutoff = cutoff;
+  Keep_All    = allflag;
+  return (bits);
+}
+
 // Trim the DB or part thereof and all opened tracks according to the cuttof and all settings
 //   of the current DB partition.  Reallocate smaller memory blocks for the information kept
 //   for the retained reads.
@@ -944,6 +1034,8 @@ void Trim_DB(DAZZ_DB *db)
   reads  = db->reads;
   nreads = db->nreads;
 
+  keep_bits(db,reads,NULL,nreads,allflag,cutoff);
+
   for (record = db->tracks; record != NULL; record = record->next)
     if (record->name == qtrack_name)
       { uint16 *table = ((DAZZ_QV *) record)->table;
@@ -969,12 +1061,12 @@ void Trim_DB(DAZZ_DB *db)
         if (record->data == NULL)
           { char *anno = (char *) record->anno;
             j = 0;
-            for (i = r = 0; i < db->nreads; i++, r += size)
+            for (i = 0; i < db->nreads; i++)
               if ((reads[i].flags & DB_BEST) >= allflag && reads[i].rlen >= cutoff)
-                { memmove(anno+j,anno+r,size);
-                  j += size;
+                { memmove(anno+((int64) j)*size,anno+((int64) i)*size,size);
+                  j += 1;
                 }
-            record->anno = Realloc(record->anno,record->size*j,NULL);
+            record->anno = Realloc(record->anno,((int64) size)*j,NULL);
           }
         else if (size == 4)
           { int *anno4 = (int *) (record->anno);
@@ -987,6 +1079,7 @@ void Trim_DB(DAZZ_DB *db)
                   alen[j]  = alen[i];
                   j += 1;
                 }
+            anno4[j] = anno4[db->nreads];
             record->alen = Realloc(record->alen,sizeof(int)*j,NULL);
             record->anno = Realloc(record->anno,record->size*(j+1),NULL);
           }
@@ -1001,6 +1094,7 @@ void Trim_DB(DAZZ_DB *db)
                   alen[j]  = alen[i];
                   j += 1;
                 }
+            anno8[j] = anno8[db->nreads];
             record->alen = Realloc(record->alen,sizeof(int)*j,NULL);
             record->anno = Realloc(record->anno,record->size*(j+1),NULL);
           }
@@ -1046,9 +1140,11 @@ int64 sizeof_DB(DAZZ_DB *db)
   DAZZ_TRACK *t;
 
   s = sizeof(DAZZ_DB)
-    + sizeof(DAZZ_READ)*(db->nreads+2)
-    + strlen(db->path)+1
-    + (db->totlen+db->nreads+4);
+    + strlen(db->path)+1;
+  if (db->loaded != DB_SHARED)
+    s += sizeof(DAZZ_READ)*(db->nreads+2);
+  if (db->loaded != DB_MAPPED && db->loaded != DB_SHARED)
+    s += db->totlen+db->nreads+4;
 
   t = db->tracks;
   if (t != NULL && strcmp(t->name,".@qvs") == 0)
@@ -1183,12 +1279,42 @@ void Print_Read(char *s, int width)
 }
 
 
+  //  A shared read segment is a Shared_Head, the read records reads[-1..nreads], and the
+  //    uncompressed bases (preceded by a delimiter) exactly as after Load_All_Reads, and
+  //    db->reads and db->bases both point into it.  It is named by a hash of the .bps file's
+  //    real path, size, and modification time, the block and trim parameters of the DB, and
+  //    ascii, so a changed DB or different settings never attach to a stale segment.  The key
+  //    hashed is also placed at the end of the segment so that a hash collision is detected,
+  //    and only a segment of the user's is attached.  The creator holds an exclusive flock on
+  //    the segment until it is populated, so others block on it rather than poll, and a
+  //    segment that is unlocked but not ready was left by a creator that died.
+
+typedef struct
+  { int64 size;      //  Size of the segment
+    int64 koff;      //  Offset of the key
+    int64 totlen;    //  For checking it is for the same reads
+    int   nreads;
+    int   ready;     //  Set once it is populated
+  } Shared_Head;
+
+#define SHARED_HEAD  64
+
 // Shut down an open 'db' by freeing all associated space, including tracks and QV structures, 
 //   and any open file pointers.  The record pointed at by db however remains (the user
 //   supplied it and so should free it).
 
 void Close_DB(DAZZ_DB *db)
-{ if (db->loaded)
+{ if (db == Keep_DB)
+    Keep_DB = NULL;
+  if (db->loaded == DB_MAPPED)
+    munmap(db->bases,db->reads[db->nreads].boff);
+  else if (db->loaded == DB_SHARED)
+    { char *map = ((char *) (db->reads-1)) - SHARED_HEAD;
+
+      munmap(map,((Shared_Head *) map)->size);
+      db->reads = NULL;
+    }
+  else if (db->loaded)
     free(((char *) (db->bases)) - 1);
   else if (db->bases != NULL)
     fclose((FILE *) db->bases);
@@ -1240,6 +1366,13 @@ int Load_Read(DAZZ_DB *db, int i, char *read, int ascii)
       EXIT(1);
     }
 
+  if (db->loaded == DB_MAPPED)
+    { len = r[i].rlen;
+      Unpack_Bases(((uint8 *) bases) + r[i].boff,0,len,read);
+      read[len] = 4;
+      goto translate;
+    }
+
   if (db->loaded)
     { len = r[i].rlen;
       strncpy(read,(char *) bases + r[i].boff,len);
@@ -1283,7 +1416,9 @@ int Load_Read(DAZZ_DB *db, int i, char *read, int ascii)
           EXIT(1);
         }
     }
+
   Uncompress_Read(len,read);
+translate:
   if (ascii == 1)
     { Lower_Read(read);
       read[-1] = '\0';
@@ -1317,6 +1452,12 @@ char *Load_Subread(DAZZ_DB *db, int i, int beg, int end, char *read, int ascii)
       EXIT(NULL);
     }
     
+  if (db->loaded == DB_MAPPED)
+    { len = end - beg;
+      Unpack_Bases(((uint8 *) bases) + r[i].boff,beg,end,read);
+      goto translate;
+    }
+
   if (db->loaded)
     { len = end-beg;
       strncpy(read,(char *) bases + r[i].boff + beg,len);
@@ -1363,8 +1504,10 @@ char *Load_Subread(DAZZ_DB *db, int i, int beg, int end, char *read, int ascii)
           EXIT(NULL);
         }
     }
+
   Uncompress_Read(4*clen,read);
   read += beg%4;
+translate:
   read[len] = 4;
   if (ascii == 1)
     { Lower_Read(read);
@@ -1380,62 +1523,464 @@ char *Load_Subread(DAZZ_DB *db, int i, int beg, int end, char *read, int ascii)
   return (read);
 }
 
+  //  Copy the compressed bases of reads[0..nreads) into seq, each at the offset it will have in
+  //    memory once uncompressed (rlen+1 bytes apart) and reset boff to that offset.  The .bps file is read in chunks of BPS_CHUNK bytes rather than a read
+  //    at a time.
+
+#define BPS_CHUNK  0x1000000
+
+static int load_bases(FILE *bases, DAZZ_READ *reads, int nreads, char *seq, char *caller)
+{ char  *buf;
+  int64  bmax, wbeg, wend, end, off, o, n;
+  int    i, len, clen;
+
+  end = 0;
+  for (i = 0; i < nreads; i++)
+    { off = reads[i].boff + COMPRESSED_LEN(reads[i].rlen);
+      if (off > end)
+        end = off;
+    }
+
+  bmax = BPS_CHUNK;
+  buf  = (char *) Malloc(bmax,"Allocating .bps buffer");
+  if (buf == NULL)
+    return (1);
+
+  wbeg = wend = 0;
+  o = 0;
+  for (i = 0; i < nreads; i++)
+    { len  = reads[i].rlen;
+      off  = reads[i].boff;
+      clen = COMPRESSED_LEN(len);
+      if (clen > 0 && (off < wbeg || off+clen > wend))
+        { if (clen > bmax)
+            { bmax = clen;
+              free(buf);
+              buf = (char *) Malloc(bmax,"Allocating .bps buffer");
+              if (buf == NULL)
+                return (1);
+            }
+          n = end-off;
+          if (n > bmax)
+            n = bmax;
+          if (ftello(bases) != off)
+            fseeko(bases,off,SEEK_SET);
+          if (fread(buf,n,1,bases) != 1)
+            { EPRINTF(EPLACE,"%s: Read of .bps file failed (%s)\n",Prog_Name,caller);
+              free(buf);
+              return (1);
+            }
+          wbeg = off;
+          wend = off+n;
+        }
+      if (clen > 0)
+        memcpy(seq+o,buf+(off-wbeg),clen);
+      reads[i].boff = o;
+      o += len+1;
+    }
+  reads[nreads].boff = o;
+
+  free(buf);
+  return (0);
+}
+
+  //  Uncompress and translate reads [beg,end) in place
+
+static void unpack_reads(DAZZ_READ *reads, int beg, int end, char *seq, int ascii)
+{ int i;
+
+  for (i = beg; i < end; i++)
+    { Uncompress_Read(reads[i].rlen,seq+reads[i].boff);
+      if (ascii == 1)
+        Lower_Read(seq+reads[i].boff);
+      else if (ascii)
+        Upper_Read(seq+reads[i].boff);
+    }
+}
+
+#ifdef DB_THREADS
+
+  //  With DB_THREADS the reads can be uncompressed in place by several threads, each taking a
+  //    range of reads with at least LOAD_MIN bases.
+
+#define LOAD_MIN  0x400000
+
+typedef struct
+  { DAZZ_READ *reads;
+    int        beg, end;
+    char      *seq;
+    int        ascii;
+  } Unpack_Arg;
+
+static void *unpack_thread(void *arg)
+{ Unpack_Arg *parm = (Unpack_Arg *) arg;
+
+  unpack_reads(parm->reads,parm->beg,parm->end,parm->seq,parm->ascii);
+  return (NULL);
+}
+
+#endif
+
+  //  Read and uncompress all the reads of db into seq (seq[-1] is set by the caller), resetting
+  //    the 'boff' of each read to be its offset in seq.  The reads are uncompressed by up to
+  //    nthreads threads if DB_THREADS is defined, and serially otherwise.
+
+static int load_reads(DAZZ_DB *db, char *seq, int ascii, int nthreads)
+{ int        nreads = db->nreads;
+  DAZZ_READ *reads = db->reads;
+
+  if (load_bases((FILE *) db->bases,reads,nreads,seq,"Load_All_Sequences"))
+    return (1);
+
+#ifdef DB_THREADS
+  if (nthreads > db->totlen/LOAD_MIN)
+    nthreads = db->totlen/LOAD_MIN;
+  if (nthreads > 1)
+    { Unpack_Arg parm[nthreads];
+      pthread_t  threads[nthreads];
+      int64      n = reads[nreads].boff;
+      int        i, j;
+
+      j = 0;
+      for (i = 0; i < nthreads; i++)
+        { parm[i].reads = reads;
+          parm[i].seq   = seq;
+          parm[i].ascii = ascii;
+          parm[i].beg   = j;
+          while (j < nreads && reads[j].boff < (n*(i+1))/nthreads)
+            j += 1;
+          if (i == nthreads-1)
+            j = nreads;
+          parm[i].end = j;
+        }
+
+      for (i = 1; i < nthreads; i++)
+        pthread_create(threads+i,NULL,unpack_thread,parm+i);
+      unpack_thread(parm);
+      for (i = 1; i < nthreads; i++)
+        pthread_join(threads[i],NULL);
+      return (0);
+    }
+#else
+  (void) nthreads;
+#endif
+
+  unpack_reads(reads,0,nreads,seq,ascii);
+  return (0);
+}
+
 // Allocate a block big enough for all the uncompressed sequences, read them into it,
 //   reset the 'off' in each read record to be its in-memory offset, and set the
 //   bases pointer to point at the block after closing the bases file.  If ascii is
 //   non-zero then the reads are converted to ACGT ascii, otherwise the reads are left
 //   as numeric strings over 0(A), 1(C), 2(G), and 3(T).
 
-int Load_All_Reads(DAZZ_DB *db, int ascii)
-{ FILE      *bases = (FILE *) db->bases;
-  int        nreads = db->nreads;
-  DAZZ_READ *reads = db->reads;
-  void     (*translate)(char *s);
-
-  char  *seq;
-  int64  o, off;
-  int    i, len, clen;
+static int load_all_reads(DAZZ_DB *db, int ascii, int nthreads)
+{ char *seq;
 
   if (db->loaded)
     return (0);
 
-  seq = (char *) Malloc(db->totlen+nreads+4,"Allocating All Sequence Reads");
+  seq = (char *) Malloc(db->totlen+db->nreads+4,"Allocating All Sequence Reads");
   if (seq == NULL)
     EXIT(1);
 
   *seq++ = 4;
 
-  if (ascii == 1)
-    translate = Lower_Read;
+  if (load_reads(db,seq,ascii,nthreads))
+    { free(seq-1);
+      EXIT(1);
+    }
+
+  fclose((FILE *) db->bases);
+
+  db->bases  = (void *) seq;
+  db->loaded = 1;
+
+  return (0);
+}
+
+int Load_All_Reads(DAZZ_DB *db, int ascii)
+{ return (load_all_reads(db,ascii,1)); }
+
+#ifdef DB_THREADS
+
+int Load_All_Reads_Threaded(DAZZ_DB *db, int ascii, int nthreads)
+{ return (load_all_reads(db,ascii,nthreads)); }
+
+#endif
+
+  //  Return the segment name for db and ascii, and in *pkey the key hashed to obtain it
+  //    (if pkey != NULL, the caller then frees it)
+
+static char *shared_name(DAZZ_DB *db, int ascii, char **pkey)
+{ static char name[50];
+  struct stat info;
+  char  *path, *key;
+  uint64 h;
+  int    len;
+
+  path = realpath(Catenate(db->path,"","",".bps"),NULL);
+  if (path == NULL || stat(path,&info) < 0)
+    { free(path);
+      return (NULL);
+    }
+
+  len = strlen(path);
+  key = (char *) Malloc(len+200,"Allocating shared segment key");
+  if (key == NULL)
+    { free(path);
+      return (NULL);
+    }
+  sprintf(key,"%s %lld %lld %d %d %d %d %d %d %d",path,(long long) info.st_size,
+              (long long) info.st_mtime,db->part,db->ufirst,db->tfirst,db->trimmed,
+              db->cutoff,(db->allarr & DB_ALL) != 0,ascii);
+
+  h = 0xcbf29ce484222325llu;
+  for (path = key; *path != '\0'; path++)
+    h = (h ^ (uint8) *path) * 0x100000001b3llu;
+  if (pkey != NULL)
+    *pkey = key;
   else
-    translate = Upper_Read;
+    free(key);
 
-  o = 0;
+  sprintf(name,"/dazz.%016llx",(unsigned long long) h);
+  return (name);
+}
+
+  //  Outcomes of trying to create or attach to a segment when NULL is returned
+
+#define SHARED_FAIL    0   //  Give up and load the reads privately
+#define SHARED_EXISTS  1   //  Segment already exists
+#define SHARED_STALE   2   //  Segment is empty or was never populated
+#define SHARED_GONE    3   //  Segment was removed before it could be opened
+#define SHARED_ERROR   4   //  The reads could not be loaded
+
+  //  Create, lock, and populate segment name of the given size for db, returning the map or NULL
+  //    with the reason in *why.
+
+static char *create_shared(DAZZ_DB *db, int ascii, char *name, char *key, int64 size, int *why)
+{ Shared_Head *head;
+  char        *map, *seq;
+  int64        rsize, koff;
+  int          fd;
+
+  rsize = sizeof(DAZZ_READ)*(db->nreads+2);
+  koff  = size - (strlen(key)+1);
+
+  *why = SHARED_FAIL;
+  fd = shm_open(name,O_RDWR|O_CREAT|O_EXCL,0600);
+  if (fd < 0)
+    { if (errno == EEXIST)
+        *why = SHARED_EXISTS;
+      return (NULL);
+    }
+  if (flock(fd,LOCK_EX) < 0 || ftruncate(fd,size) < 0)
+    { shm_unlink(name);
+      close(fd);
+      return (NULL);
+    }
+  map = (char *) mmap(NULL,size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+  if (map == MAP_FAILED)
+    { shm_unlink(name);
+      close(fd);
+      return (NULL);
+    }
+
+  head = (Shared_Head *) map;
+  seq  = map + SHARED_HEAD + rsize;
+  *seq++ = 4;
+  if (load_reads(db,seq,ascii,1))
+    { munmap(map,size);
+      shm_unlink(name);
+      close(fd);
+      *why = SHARED_ERROR;
+      return (NULL);
+    }
+  memcpy(map+SHARED_HEAD,db->reads-1,rsize);
+  strcpy(map+koff,key);
+
+  head->size   = size;
+  head->koff   = koff;
+  head->totlen = db->totlen;
+  head->nreads = db->nreads;
+  __atomic_store_n(&(head->ready),1,__ATOMIC_RELEASE);
+  mprotect(map,size,PROT_READ);
+
+  close(fd);                //  Releases the lock
+  return (map);
+}
+
+  //  Attach to existing segment name of the given size for db once it is populated, returning
+  //    the map or NULL with the reason in *why.
+
+static char *attach_shared(DAZZ_DB *db, char *name, char *key, int64 size, int *why)
+{ struct stat  info;
+  Shared_Head *head;
+  char        *map;
+  int          fd;
+
+  *why = SHARED_FAIL;
+  fd = shm_open(name,O_RDONLY,0);
+  if (fd < 0)
+    { if (errno == ENOENT)
+        *why = SHARED_GONE;
+      return (NULL);
+    }
+
+  //  Only a segment created by this user is trusted.  Once the shared lock is had the
+  //    creator has finished or died.
+
+  if (fstat(fd,&info) < 0 || info.st_uid != geteuid() || flock(fd,LOCK_SH) < 0)
+    { close(fd);
+      return (NULL);
+    }
+  if (fstat(fd,&info) < 0)
+    { close(fd);
+      return (NULL);
+    }
+  if (info.st_size < SHARED_HEAD)
+    { close(fd);
+      *why = SHARED_STALE;
+      return (NULL);
+    }
+  if (info.st_size != size)
+    { close(fd);
+      return (NULL);
+    }
+  map = (char *) mmap(NULL,size,PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return (NULL);
+
+  head = (Shared_Head *) map;
+  if (__atomic_load_n(&(head->ready),__ATOMIC_ACQUIRE) == 0)
+    { munmap(map,size);
+      *why = SHARED_STALE;
+      return (NULL);
+    }
+  if (head->koff != size - (int64) (strlen(key)+1) || head->nreads != db->nreads
+       || head->totlen != db->totlen || strcmp(map+head->koff,key) != 0)
+    { munmap(map,size);
+      return (NULL);
+    }
+  return (map);
+}
+
+// As for Load_All_Reads, but the records and uncompressed bases are held in a shared memory
+//   segment that the first process to ask for it populates and later ones map read-only.
+
+int Share_All_Reads(DAZZ_DB *db, int ascii)
+{ char *name, *key, *map;
+  int64 size;
+  int   why, tries;
+
+  if (db->loaded)
+    return (0);
+
+  name = shared_name(db,ascii,&key);
+  if (name == NULL)
+    return (Load_All_Reads(db,ascii));
+
+  size = SHARED_HEAD + sizeof(DAZZ_READ)*(db->nreads+2) + db->totlen + db->nreads + 4
+       + strlen(key) + 1;
+
+  //  A stale segment is removed and the creation retried, but only a couple of times as
+  //    another process might be doing the same
+
+  map = NULL;
+  why = SHARED_FAIL;
+  for (tries = 0; tries < 3; tries++)
+    { map = create_shared(db,ascii,name,key,size,&why);
+      if (map != NULL || why != SHARED_EXISTS)
+        break;
+      map = attach_shared(db,name,key,size,&why);
+      if (map != NULL || (why != SHARED_STALE && why != SHARED_GONE))
+        break;
+      if (why == SHARED_STALE)
+        shm_unlink(name);
+    }
+  free(key);
+
+  if (why == SHARED_ERROR)
+    EXIT(1);
+  if (map == NULL)
+    return (Load_All_Reads(db,ascii));
+
+  fclose((FILE *) db->bases);
+  free(db->reads-1);
+
+  db->reads  = ((DAZZ_READ *) (map + SHARED_HEAD)) + 1;
+  db->bases  = (void *) (map + SHARED_HEAD + sizeof(DAZZ_READ)*(db->nreads+2) + 1);
+  db->loaded = DB_SHARED;
+
+  return (0);
+}
+
+// Remove the shared memory segment (if any) Share_All_Reads would use for db and ascii
+
+int Unshare_All_Reads(DAZZ_DB *db, int ascii)
+{ char *name;
+
+  name = shared_name(db,ascii,NULL);
+  if (name == NULL || shm_unlink(name) < 0)
+    return (1);
+  return (0);
+}
+
+// Memory map the part of the .bps file holding the 2-bit compressed reads of db, shifting the
+//   'off' of each read to be its offset in the map and setting the bases pointer to point at
+//   the map after closing the bases file.  The map is shared with every other process mapping
+//   the same file, and reads are uncompressed on demand by Load_Read and Load_Subread, or
+//   directly from the map by the caller.  reads[nreads].boff is set to the
+//   size of the map.
+
+int Map_All_Reads(DAZZ_DB *db)
+{ FILE      *bases = (FILE *) db->bases;
+  int        nreads = db->nreads;
+  DAZZ_READ *reads = db->reads;
+
+  struct stat info;
+  int64  beg, end, off, page;
+  char  *map;
+  int    i;
+
+  if (db->loaded)
+    return (0);
+
+  beg = end = 0;
   for (i = 0; i < nreads; i++)
-    { len = reads[i].rlen;
-      off = reads[i].boff;
-      if (ftello(bases) != off)
-        fseeko(bases,off,SEEK_SET);
-      clen = COMPRESSED_LEN(len);
-      if (clen > 0)
-        { if (fread(seq+o,clen,1,bases) != 1)
-            { EPRINTF(EPLACE,"%s: Read of .bps file failed (Load_All_Sequences)\n",Prog_Name);
-              free(seq-1);
-              EXIT(1);
-            }
-        }
-      Uncompress_Read(len,seq+o);
-      if (ascii)
-        translate(seq+o);
-      reads[i].boff = o;
-      o += (len+1);
+    { off = reads[i].boff;
+      if (i == 0 || off < beg)
+        beg = off;
+      off += COMPRESSED_LEN(reads[i].rlen);
+      if (off > end)
+        end = off;
+    }
+  page = sysconf(_SC_PAGESIZE);
+  beg -= beg % page;
+
+  if (fstat(fileno(bases),&info) < 0 || info.st_size < end)
+    { EPRINTF(EPLACE,"%s: .bps file is truncated (Map_All_Reads)\n",Prog_Name);
+      EXIT(1);
     }
-  reads[nreads].boff = o;
+
+  if (end <= beg)
+    end = beg+1;
+  map = (char *) mmap(NULL,end-beg,PROT_READ,MAP_SHARED,fileno(bases),beg);
+  if (map == MAP_FAILED)
+    { EPRINTF(EPLACE,"%s: Cannot memory map .bps file (Map_All_Reads)\n",Prog_Name);
+      EXIT(1);
+    }
+
+  for (i = 0; i < nreads; i++)
+    reads[i].boff -= beg;
+  reads[nreads].boff = end-beg;
 
   fclose(bases);
 
-  db->bases  = (void *) seq;
-  db->loaded = 1;
+  db->bases  = (void *) map;
+  db->loaded = DB_MAPPED;
 
   return (0);
 }
@@ -1704,15 +2249,14 @@ int Check_Track(DAZZ_DB *db, char *track, int *kind)
 }
 
 // The DB has already been trimmed, but a track over the untrimmed DB needs to be opened.
-//   Trim the track by rereading the untrimmed DB index from the file system.
+//   Trim the track with the vector of kept reads made when the DB was trimmed, or if that is
+//   gone, one made by rereading the untrimmed DB index from the file system in bulk.
 
-static int Late_Track_Trim(DAZZ_DB *db, DAZZ_TRACK *track, int ispart)
-{ int         i, j, r;
+static int Late_Track_Trim(DAZZ_DB *db, DAZZ_TRACK *track)
+{ int         i, j;
   int         allflag, cutoff;
   int         ureads;
-  char       *root;
-  DAZZ_READ   read;
-  FILE       *indx;
+  uint64     *bits;
 
   if (db->cutoff <= 0 && (db->allarr & DB_ALL) != 0) return (0);
 
@@ -1722,33 +2266,37 @@ static int Late_Track_Trim(DAZZ_DB *db, DAZZ_TRACK *track, int ispart)
   else
     allflag = DB_BEST;
 
-  root = rindex(db->path,'/') + 2;
-  indx = Fopen(MyCatenate(db->path,"","",".idx"),"r");
-  fseeko(indx,sizeof(DAZZ_DB) + sizeof(DAZZ_READ)*db->ufirst,SEEK_SET);
-  if (ispart)
-    ureads = ((int *) (db->reads))[-1];
+  ureads = ((int *) (db->reads))[-1];     //  Open_Track read the block's records if ! ispart
+
+  if (Keep_DB == db && Keep_First == db->ufirst && Keep_Reads == ureads
+                    && Keep_Cutoff == cutoff && Keep_All == allflag
+                    && strcmp(Keep_Path,db->path) == 0)
+    bits = Keep_Bits;
   else
-    ureads = db->ureads;
+    { FILE *indx;
+
+      indx = Fopen(MyCatenate(db->path,"","",".idx"),"r");
+      if (indx == NULL)
+        EXIT(1);
+      fseeko(indx,sizeof(DAZZ_DB) + sizeof(DAZZ_READ)*db->ufirst,SEEK_SET);
+      bits = keep_bits(db,NULL,indx,ureads,allflag,cutoff);
+      fclose(indx);
+      if (bits == NULL)
+        EXIT(1);
+    }
 
   { int    size;
 
     size = track->size;
     if (track->data == NULL)
       { char *anno = (char *) track->anno;
-        j = r = 0;
-        for (i = r = 0; i < ureads; i++, r += size)
-          { if (fread(&read,sizeof(DAZZ_READ),1,indx) != 1)
-              { EPRINTF(EPLACE,"%s: Index file (.idx) of %s is junk\n",Prog_Name,root);
-                fclose(indx);
-                EXIT(1);
-              }
-            if ((read.flags & DB_BEST) >= allflag && read.rlen >= cutoff)
-              { memmove(anno+j,anno+r,size);
-                j += size;
-              }
-            r += size;
-          }
-        track->anno = Realloc(track->anno,track->size*j,NULL);
+        j = 0;
+        for (i = 0; i < ureads; i++)
+          if (KEPT(bits,i))
+            { memmove(anno+((int64) j)*size,anno+((int64) i)*size,size);
+              j += 1;
+            }
+        track->anno = Realloc(track->anno,((int64) size)*j,NULL);
       }
     else if (size == 4)
       { int *anno4 = (int *) (track->anno);
@@ -1756,17 +2304,12 @@ static int Late_Track_Trim(DAZZ_DB *db, DAZZ_TRACK *track, int ispart)
 
         j = 0;
         for (i = 0; i < ureads; i++)
-          { if (fread(&read,sizeof(DAZZ_READ),1,indx) != 1)
-              { EPRINTF(EPLACE,"%s: Index file (.idx) of %s is junk\n",Prog_Name,root);
-                fclose(indx);
-                EXIT(1);
-              }
-            if ((read.flags & DB_BEST) >= allflag && read.rlen >= cutoff)
-              { anno4[j] = anno4[i];
-                alen[j]  = alen[i];
-                j += 1;
-              }
-          }
+          if (KEPT(bits,i))
+            { anno4[j] = anno4[i];
+              alen[j]  = alen[i];
+              j += 1;
+            }
+        anno4[j] = anno4[ureads];
         track->alen = Realloc(track->alen,sizeof(int)*j,NULL);
         track->anno = Realloc(track->anno,track->size*(j+1),NULL);
       }
@@ -1776,23 +2319,18 @@ static int Late_Track_Trim(DAZZ_DB *db, DAZZ_TRACK *track, int ispart)
 
         j = 0;
         for (i = 0; i < ureads; i++)
-          { if (fread(&read,sizeof(DAZZ_READ),1,indx) != 1)
-              { EPRINTF(EPLACE,"%s: Index file (.idx) of %s is junk\n",Prog_Name,root);
-                fclose(indx);
-                EXIT(1);
-              }
-            if ((read.flags & DB_BEST) >= allflag && read.rlen >= cutoff)
-              { anno8[j] = anno8[i];
-                alen[j]  = alen[i];
-                j += 1;
-              }
-          }
+          if (KEPT(bits,i))
+            { anno8[j] = anno8[i];
+              alen[j]  = alen[i];
+              j += 1;
+            }
+        anno8[j] = anno8[ureads];
         track->alen = Realloc(track->alen,sizeof(int)*j,NULL);
         track->anno = Realloc(track->anno,track->size*(j+1),NULL);
       }
+    track->nreads = j;
   }
 
-  fclose(indx);
   return (0);
 }
 
@@ -1976,7 +2514,7 @@ DAZZ_TRACK *Open_Track(DAZZ_DB *db, char *track)
   record->dmax   = dmax;
 
   if (db->trimmed && tracklen != treads)
-    { if (Late_Track_Trim(db,record,ispart))
+    { if (Late_Track_Trim(db,record))
         goto error;
     }
 
@@ -2040,7 +2578,7 @@ int Load_Track_Data(DAZZ_TRACK *track, int i, void *data)
   len = track->alen[i];
 
   if (track->loaded)
-    { strncpy(data,(void *) track->data + off,len);
+    { memcpy(data,(void *) track->data + off,len);
       return (len);
     }
 
@@ -2133,6 +2671,131 @@ int Load_All_Track_Data(DAZZ_TRACK *track)
   return (0);
 }
 
+// Memory map the portion of the .data file holding the track data, reset the 'off' in each
+//   anno pointer to be its offset in the map, set anno[nreads] to the size of the map, and
+//   set the data pointer to point at the map after closing the data file.  Pages of the map
+//   are shared with every other process mapping the same track.  Return with a zero, except
+//   when an error occurs and INTERACTIVE is defined in which case return wtih 1.
+
+int Map_All_Track_Data(DAZZ_TRACK *track)
+{ FILE  *dfile;
+  int   *alen;
+  int64  beg, end, off, page;
+  int    i, nreads;
+  char  *map;
+
+  struct stat info;
+
+  if (track->loaded || track->data == NULL)
+    return (0);
+
+  nreads = track->nreads;
+  dfile  = (FILE *) track->data;
+  alen   = track->alen;
+
+  beg = end = 0;
+  for (i = 0; i < nreads; i++)
+    { if (track->size == 4)
+        off = ((int *) track->anno)[i];
+      else
+        off = ((int64 *) track->anno)[i];
+      if (i == 0 || off < beg)
+        beg = off;
+      off += alen[i];
+      if (off > end)
+        end = off;
+    }
+  page = sysconf(_SC_PAGESIZE);
+  beg -= beg % page;
+
+  if (fstat(fileno(dfile),&info) < 0 || info.st_size < end)
+    { EPRINTF(EPLACE,"%s: .data file is truncated (Map_All_Track_Data)\n",Prog_Name);
+      EXIT(1);
+    }
+
+  if (end <= beg)
+    end = beg+1;
+  map = (char *) mmap(NULL,end-beg,PROT_READ,MAP_SHARED,fileno(dfile),beg);
+  if (map == MAP_FAILED)
+    { EPRINTF(EPLACE,"%s: Cannot memory map .data file (Map_All_Track_Data)\n",Prog_Name);
+      EXIT(1);
+    }
+
+  if (track->size == 4)
+    { int *anno4 = (int *) track->anno;
+
+      for (i = 0; i < nreads; i++)
+        anno4[i] -= beg;
+      anno4[nreads] = end-beg;
+    }
+  else
+    { int64 *anno8 = (int64 *) track->anno;
+
+      for (i = 0; i < nreads; i++)
+        anno8[i] -= beg;
+      anno8[nreads] = end-beg;
+    }
+
+  fclose(dfile);
+
+  track->data   = (void *) map;
+  track->loaded = TRACK_MAPPED;
+
+  return (0);
+}
+
+// Return a pointer to read i's data block within the loaded or mapped track data and place
+//   its length in bytes in *len.  Nothing is copied.  Return NULL if the data is not in memory,
+//   or if i is out of bounds and INTERACTIVE is defined.
+
+void *Track_Data_Span(DAZZ_TRACK *track, int i, int *len)
+{ int64 off;
+
+  if (i < 0 || i >= track->nreads)
+    { EPRINTF(EPLACE,"%s: Index out of bounds (Track_Data_Span)\n",Prog_Name);
+      EXIT(NULL);
+    }
+
+  *len = 0;
+  if (track->data == NULL || ! track->loaded)
+    return (NULL);
+
+  if (track->size == 4)
+    off = ((int *) track->anno)[i];
+  else
+    off = ((int64 *) track->anno)[i];
+  *len = track->alen[i];
+  return (((char *) track->data) + off);
+}
+
+// For a mask track whose data for each read is a sorted list of disjoint [b,e) int pairs,
+//   return 1 if interval [beg,end) of read i intersects a masked interval, and 0 otherwise.
+//   A position p is tested with [p,p+1).  The pairs are binary searched so the cost is
+//   O(log k) for a read with k intervals.  The track data must be loaded or mapped, and
+//   -1 is returned if it is not and INTERACTIVE is defined.
+
+int Track_Masked(DAZZ_TRACK *track, int i, int beg, int end)
+{ int *iv;
+  int  len, l, r, m;
+
+  iv = (int *) Track_Data_Span(track,i,&len);
+  if (iv == NULL)
+    { EPRINTF(EPLACE,"%s: Track data is not in memory (Track_Masked)\n",Prog_Name);
+      EXIT(-1);
+    }
+
+  l = 0;                          //  Find the first pair whose end is past beg
+  r = len / (2*sizeof(int));
+  while (l < r)
+    { m = (l+r)/2;
+      if (iv[2*m+1] <= beg)
+        l = m+1;
+      else
+        r = m;
+    }
+  return (l < (int) (len / (2*sizeof(int))) && iv[2*l] < end);
+}
+
 
 // Assumming file pointer for afile is correctly positioned at the start of a extra item,
 //   and aname is the name of the .anno file, decode the value present and places it in
@@ -2292,12 +2955,18 @@ void Close_Track(DAZZ_DB *db, DAZZ_TRACK *track)
   prev = NULL;
   for (record = db->tracks; record != NULL; record = record->next)
     { if (track == record)
-        { free(record->anno);
-          free(record->alen);
-          if (record->loaded)
+        { if (record->loaded == TRACK_MAPPED)
+            { if (record->size == 4)
+                munmap(record->data,((int *) record->anno)[record->nreads]);
+              else
+                munmap(record->data,((int64 *) record->anno)[record->nreads]);
+            }
+          else if (record->loaded)
             free(record->data);
           else
             fclose((FILE *) record->data);
+          free(record->anno);
+          free(record->alen);
           free(record->name);
           if (prev == NULL)
             db->tracks = record->next;
@@ -302,6 +302,8 @@ typedef struct
 //                                    contains the variable length data
 //    if loaded is set then the data is not loaded if present, rather data is an open file pointer
 //        set for reading.
+//    if loaded == TRACK_MAPPED then data is a read-only memory map of the .data file and
+//        anno[nreads] is the size of the map.
 
 typedef struct _track
   { struct _track *next;   //  Link to next track
@@ -315,6 +317,8 @@ typedef struct _track
     int64          dmax;   //  Largest read data segment in bytes
   } DAZZ_TRACK;
 
+#define TRACK_MAPPED 2     //  'loaded' value when the track data is a memory map of the .data file
+
 //  The tailing part of a .anno track file can contain meta-information produced by the
 //    command that produced the track.  For example, the coverage, or good/bad parameters
 //    for trimming, or even say a histogram of QV values.  Each item is an array of 'nelem'
@@ -412,12 +416,18 @@ typedef struct
        //    integer spaces of the record.
 
     char       *path;       //  Root name of DB for .bps, .qvs, and tracks
-    int         loaded;     //  Are reads loaded in memory?
+    int         loaded;     //  Are reads loaded in memory? (DB_MAPPED if still 2-bit compressed
+                            //    in a memory map of the .bps file,
+                            //    DB_SHARED if uncompressed in a shared memory segment)
     void       *bases;      //  file pointer for bases file (to fetch reads from),
-                            //    or memory pointer to uncompressed block of all sequences.
+                            //    or memory pointer to uncompressed block of all sequences,
+                            //    or memory pointer to compressed block if loaded == DB_MAPPED.
     DAZZ_READ  *reads;      //  Array [-1..nreads] of DAZZ_READ
     DAZZ_TRACK *tracks;     //  Linked list of loaded tracks
-  } DAZZ_DB; 
+  } DAZZ_DB;
+
+#define DB_MAPPED 3         //  'loaded' value when reads are in a shared map of the .bps file
+#define DB_SHARED 4         //  'loaded' value when reads are uncompressed in a shared memory segment
 
 
 /*******************************************************************************************
@@ -547,12 +557,48 @@ char *Load_Subread(DAZZ_DB *db, int i, int beg, int end, char *read, int ascii);
 
   // Allocate a block big enough for all the uncompressed read sequences and read and uncompress
   //   the reads into it, reset the 'boff' in each read record to be its in-memory offset,
-  //   and set the bases pointer to point at the block after closing the bases file.  Return
-  //   with a zero, except when an error occurs and INTERACTIVE is defined in which
-  //   case return wtih 1.
+  //   and set the bases pointer to point at the block after closing the bases file.  The
+  //   .bps file is read in large chunks.  Return with a zero, except when an error occurs
+  //   and INTERACTIVE is defined in which case return wtih 1.
 
 int Load_All_Reads(DAZZ_DB *db, int ascii);
 
+  // Exactly as Load_All_Reads, save that a large block is uncompressed by up to nthreads
+  //   threads.  Only available if DB.c (and the caller) are compiled with -DDB_THREADS, in
+  //   which case the program must be linked with -lpthread.
+
+#ifdef DB_THREADS
+int Load_All_Reads_Threaded(DAZZ_DB *db, int ascii, int nthreads);
+#endif
+
+  // Exactly as Load_All_Reads, save that the read records and uncompressed reads are placed in a
+  //   node-wide shared memory segment (named /dazz.<hash>) keyed by the DB's .bps file, block,
+  //   and trim parameters, and ascii.  The first process to ask for a segment populates it
+  //   and others with the same key wait for it and then map it read-only, so concurrent jobs
+  //   on a node hold one copy of a block and do the work of loading it once.  Both db->reads
+  //   and db->bases then point into the segment and must not be modified.  'loaded' is set
+  //   to DB_SHARED.  A segment left empty or unpopulated by a process that died is removed
+  //   and created anew, and if a segment cannot be created or populated then the reads are
+  //   loaded privately.  Only a segment created by the same user is attached.  A segment
+  //   persists until removed with Unshare_All_Reads (e.g. by datander -u) or a reboot.
+
+int Share_All_Reads(DAZZ_DB *db, int ascii);
+
+  // Remove the shared memory segment for db and ascii, returning 1 if there is none.
+
+int Unshare_All_Reads(DAZZ_DB *db, int ascii);
+
+  // Memory map the part of the .bps file holding the 2-bit compressed reads of the (trimmed)
+  //   db instead of loading them, so that processes working on the same DB share one copy in
+  //   the page cache.  Each read starts on a byte boundary (4 bases per byte, first base in the
+  //   high order bits), 'boff' is the offset of a read in the map, and 'loaded' is set to
+  //   DB_MAPPED.
+  //   Load_Read and Load_Subread uncompress just the bases asked for straight from the map.
+  //   Return with a zero, except when an error occurs and INTERACTIVE is defined in which
+  //   case return with 1.
+
+int Map_All_Reads(DAZZ_DB *db);
+
 
 /*******************************************************************************************
  *
@@ -636,6 +682,24 @@ int Load_Track_Data(DAZZ_TRACK *track, int i, void *data);
 
 int Load_All_Track_Data(DAZZ_TRACK *track);
 
+  // Memory map the track data instead of reading it, reset the 'off' in each anno pointer to be
+  //   its offset in the map, and set 'loaded' to TRACK_MAPPED.  Pages of the map are shared
+  //   between all processes on a node that map the same track.  Return with a zero, except
+  //   when an error occurs and INTERACTIVE is defined in which case return wtih 1.
+
+int Map_All_Track_Data(DAZZ_TRACK *track);
+
+  // Return a pointer to read i's data in the loaded or mapped track data, without copying it,
+  //   and set *len to its length in bytes.  NULL is returned if the data is not in memory.
+
+void *Track_Data_Span(DAZZ_TRACK *track, int i, int *len);
+
+  // For a loaded or mapped mask track (e.g. .tan, .rep, or .dust), return 1 if [beg,end) of
+  //   read i intersects a masked interval and 0 otherwise in O(log k) time for a read with
+  //   k intervals.  Test a single position p with [p,p+1).
+
+int Track_Masked(DAZZ_TRACK *track, int i, int beg, int end);
+
   // Assumming file pointer for afile is correctly positioned at the start of an extra item,
   //   and aname is the name of the .anno file, decode the value present and place it in
   //   extra if extra->nelem == 0, otherwise reduce the value just read into extra according
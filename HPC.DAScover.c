@@ -29,7 +29,7 @@
 
 static char *Usage[] =
   { "[-vlF] [-U(w<int(64)> |t<double(2.)> |m<int(10)> |b) ]",
-    "   [-S(k<int(12)> |w<int(4)> |h<int(35)> |e<double(.7)> |l<int(500)>) ]",
+    "   [-S(k<int(12)> |w<int(4)> |h<int(35)> |e<double(.7)> |l<int(500)> |s) ]",
     "   [-L(k<int(14)> |w<int(6)> |h<int(35)> |e<double(.7)> |l<int(1000)> |t<int>) ]",
     "   [-c<int(10)>] [-s<int(100)] [-M<int>] [-P<dir(/tmp)>] [-T<int(4)>]",
     "   [-B<int(4)>] [-f<name>] <reads:db|dam> [<target:int(1)>]"
@@ -65,6 +65,7 @@ int main(int argc, char *argv[])
   int   S_HITS;
   float S_ERATE;
   int   S_OLEN;
+  int   S_SHARE;
     
   int   D_KMER;
   int   D_BAND;
@@ -99,6 +100,7 @@ int main(int argc, char *argv[])
     S_HITS  = 35;
     S_ERATE = 0.;
     S_OLEN  = 500;
+    S_SHARE = 0;
 
     D_FREQ  = -1;
     D_KMER  = 14;
@@ -176,6 +178,9 @@ int main(int argc, char *argv[])
               case 'l':
                 ARG_POSITIVE(S_OLEN, "Datander minimum alignment length")
                 break;
+              case 's':
+                S_SHARE = 1;
+                break;
               case 'w':
                 ARG_POSITIVE(S_BAND, "Datander band width")
                 break;
@@ -255,6 +260,7 @@ int main(int argc, char *argv[])
         fprintf(stderr,          " targest read.\n");
         fprintf(stderr,"      -Se: Look for alignments with -e percent similarity.\n");
         fprintf(stderr,"      -Sl: Look for alignments of length >= -l.\n");
+        fprintf(stderr,"      -Ss: Share each loaded block with other jobs on a node.\n");
         fprintf(stderr,"\n");
         fprintf(stderr,"     Daligner parameters.\n");
         fprintf(stderr,"      -Lk: k-mer size (must be <= 32).\n");
@@ -457,6 +463,8 @@ int main(int argc, char *argv[])
               fprintf(out, " -P%s", TMPDIR);
             if (NTHREADS != 4)
               fprintf(out, " -T%d", NTHREADS);
+            if (S_SHARE)
+              fprintf(out, " -S");
       
             for (k = i; k < j; k++)
               if (usepath)
@@ -545,6 +553,18 @@ int main(int argc, char *argv[])
             for (k = i; k < j; k++)
               fprintf(out, " TAN.%s.%d.las", root, k);
             fprintf(out, "\n");
+
+            //  Shared blocks are per node, so this must run on each node datander ran on
+
+            if (S_SHARE)
+              { fprintf(out, "datander -u");
+                for (k = i; k < j; k++)
+                  if (usepath)
+                    fprintf(out, " %s/%s.%d", pwd, root, k);
+                  else
+                    fprintf(out, " %s.%d", root, k);
+                fprintf(out, "\n");
+              }
           }
       
         // REPEAT MASKING
@@ -22,7 +22,7 @@
 #undef  SLURM  //  define if want a directly executable SLURM script
 
 static char *Usage[] =
-  { "[-vbd] [-t<int>] [-w<int(6)>] [-l<int(1000)>] [-s<int(100)>] [-M<int>]",
+  { "[-vbdu] [-t<int>] [-w<int(6)>] [-l<int(1000)>] [-s<int(100)>] [-M<int>]",
     "       [-n<name(rep-g)>] [-P<dir(/tmp)>] [-B<int(4)>] [T<int(4)>] [-f<name>]",
     "       [-k<int(14)>] [-h<int(35)>] [-e<double(.70)>] [-m<track>]+",
     "       -g<int> -c<int> <reads:db|dam> [<block:int>[-<range:int>]"
@@ -73,7 +73,7 @@ int main(int argc, char *argv[])
 
   int    CINT, SPAN;
   int    BUNIT;
-  int    VON, BON, DON;
+  int    VON, BON, DON, UON;
   int    WINT, TINT, HINT, KINT, SINT, LINT, MINT;
   int    NTHREADS;
   char  *MASK_NAME, defname[25];
@@ -119,7 +119,7 @@ int main(int argc, char *argv[])
       if (argv[i][0] == '-')
         switch (argv[i][1])
         { default:
-            ARG_FLAGS("vbd");
+            ARG_FLAGS("vbdu");
             break;
           case 'c':
             ARG_POSITIVE(CINT,"Repeat coverage threshold")
@@ -191,6 +191,7 @@ int main(int argc, char *argv[])
     VON = flags['v'];
     BON = flags['b'];
     DON = flags['d'];
+    UON = flags['u'];
 
     if (argc < 2 || argc > 3)
       { fprintf(stderr,"Usage: %s %s\n",Prog_Name,Usage[0]);
@@ -223,6 +224,7 @@ int main(int argc, char *argv[])
         fprintf(stderr,"      -v: Run all commands in script in verbose mode.\n");
         fprintf(stderr,"      -g: # of blocks per comparison group.\n");
         fprintf(stderr,"      -d: Put .las files for each target block in a sub-directory\n");
+        fprintf(stderr,"      -u: Do not merge block-pair .las files, REPmask -m merges them\n");
         fprintf(stderr,"      -B: # of block compares per daligner job\n");
         fprintf(stderr,"      -f: Place script bundles in separate files with prefix <name>\n");
         exit (1);
@@ -364,6 +366,7 @@ int main(int argc, char *argv[])
       }
 
     DON = (DON && (SPAN > 1));
+    UON = (UON && (SPAN > 1));
   }
 
   { int njobs;
@@ -545,9 +548,9 @@ int main(int argc, char *argv[])
     if (ONAME != NULL)
       fclose(out);
 
-    //  Merges required if SPAN > 1
+    //  Merges required if SPAN > 1 (unless REPmask is to merge the block-pair files)
 
-    if (SPAN > 1)
+    if (SPAN > 1 && ! UON)
       { if (ONAME != NULL)
           { sprintf(name,"%s.03.MERGE",ONAME);
             out = fopen(name,"w");
@@ -636,12 +639,29 @@ int main(int argc, char *argv[])
           fprintf(out,"REPmask");
           if (VON)
             fprintf(out," -v");
+          if (UON)
+            fprintf(out," -m");
           fprintf(out," -c%d -n%s",CINT,MASK_NAME);
+          if (NTHREADS != 4)
+            fprintf(out," -T%d",NTHREADS);
           if (usepath)
             fprintf(out," %s/%s",pwd,root);
           else
             fprintf(out," %s",root);
-          if (DON)
+          if (UON)
+            for (k = low; k <= hgh; k++)
+              { int base;
+
+                base = fblock + ((k-fblock)/SPAN)*SPAN;
+                if (base + SPAN > lblock+1)
+                  base = (lblock+1)-SPAN;
+                if (DON)
+                  fprintf(out," temp%d/%s.%d.%s.%c%d-%d",
+                              k,root,k,root,BLOCK_SYMBOL,base,base+(SPAN-1));
+                else
+                  fprintf(out," %s.%d.%s.%c%d-%d",root,k,root,BLOCK_SYMBOL,base,base+(SPAN-1));
+              }
+          else if (DON)
             fprintf(out," temp%d/%s.R%d.%c%d-%d",k,root,SPAN,BLOCK_SYMBOL,low,hgh);
           else
             fprintf(out," %s.R%d.%c%d-%d",root,SPAN,BLOCK_SYMBOL,low,hgh);
@@ -660,11 +680,16 @@ int main(int argc, char *argv[])
 
     if (DON)
       fprintf(out,"# Cleanup all temporary directories\n");
+    else if (UON)
+      fprintf(out,"# Cleanup all block-pair .las files\n");
     else
       fprintf(out,"# Cleanup all R%d.las files\n",SPAN);
 
     if (DON)
       fprintf(out,"rm -r temp*\n");
+    else if (UON)
+      for (j = fblock; j <= lblock; j++)
+        fprintf(out,"rm %s.%d.%s.*.las\n",root,j,root);
     else
       fprintf(out,"rm %s.R%d.*.las\n",root,SPAN);
   
@@ -673,16 +698,12 @@ int main(int argc, char *argv[])
   }
 
   printf("# Once all the .rep masks have been computed for every block\n");
-  printf("#   you should call 'Catrack' to merge them, and then you should\n");
+  printf("#   you should call 'CATmask' (or 'Catrack') to merge them and\n");
   printf("#   remove the individual block tracks, e.g.:\n");
   if (usepath)
-    { printf("#      Catrack -v %s/%s %s\n",pwd,root,MASK_NAME);
-      printf("#      rm %s/.%s.*.%s.*\n",pwd,root,MASK_NAME);
-    }
+    printf("#      CATmask -vd %s/%s %s\n",pwd,root,MASK_NAME);
   else
-    { printf("#      Catrack -v %s %s\n",root,MASK_NAME);
-      printf("#      rm .%s.*.%s.*\n",root,MASK_NAME);
-    }
+    printf("#      CATmask -vd %s %s\n",root,MASK_NAME);
 
 
   free(root);
@@ -22,7 +22,7 @@
 #undef  SLURM  //  define if want a directly executable SLURM script
 
 static char *Usage[] =
-  { "[-v] [-k<int(12)>] [-w<int(4)>] [-h<int(35)>] [-T<int(4)>] [-P<dir(/tmp)>]",
+  { "[-vS] [-k<int(12)>] [-w<int(4)>] [-h<int(35)>] [-T<int(4)>] [-P<dir(/tmp)>]",
     "     [-n<name(tan)>] [-e<double(.70)] [-l<int(500)>] [-s<int(100)] [-f<name>]",
     "     <reads:db|dam> [<first:int>[-<last:int>]"
   };
@@ -69,7 +69,7 @@ int main(int argc, char *argv[])
 
 #define BUNIT  4
 
-  int    VON;
+  int    VON, SON;
   int    WINT, HINT, KINT, SINT, LINT;
   int    NTHREADS;
   char  *MASK_NAME;
@@ -101,7 +101,7 @@ int main(int argc, char *argv[])
       if (argv[i][0] == '-')
         switch (argv[i][1])
         { default:
-            ARG_FLAGS("v");
+            ARG_FLAGS("vS");
             break;
           case 'e':
             ARG_REAL(EREL)
@@ -147,6 +147,7 @@ int main(int argc, char *argv[])
     argc = j;
 
     VON = flags['v'];
+    SON = flags['S'];
 
     if (argc < 2 || argc > 3)
       { fprintf(stderr,"Usage: %s %s\n",Prog_Name,Usage[0]);
@@ -165,6 +166,7 @@ int main(int argc, char *argv[])
         fprintf(stderr,"\n");
         fprintf(stderr,"      -T: Use -T threads.\n");
         fprintf(stderr,"      -P: Do first level sort and merge in directory -P.\n");
+        fprintf(stderr,"      -S: Share each loaded block with other jobs on a node.\n");
         fprintf(stderr,"\n");
         fprintf(stderr,"     Passed through to TANmask.\n");
         fprintf(stderr,"      -l: minimum tandem mask interval to report.\n");
@@ -340,6 +342,8 @@ int main(int argc, char *argv[])
           fprintf(out," -P%s",PDIR);
         if (NTHREADS != 4)
           fprintf(out," -T%d",NTHREADS);
+        if (SON)
+          fprintf(out," -S");
         j = i+BUNIT;
         if (j > lblock+1)
           j = lblock+1;
@@ -423,6 +427,8 @@ int main(int argc, char *argv[])
           fprintf(out," -v");
         if (LINT != 500)
           fprintf(out," -l%d",LINT);
+        if (NTHREADS != 4)
+          fprintf(out," -T%d",NTHREADS);
         if (usepath)
           fprintf(out," %s/%s",pwd,root);
         else
@@ -463,21 +469,42 @@ int main(int argc, char *argv[])
         fprintf(out,"\n");
       }
 
+    //  Shared blocks are per node, so these must run on each node datander ran on
+
+    if (SON)
+      { fprintf(out,"# Remove the shared copies of the blocks made by datander -S\n");
+
+        for (i = fblock; i <= lblock; i += BUNIT)
+          { fprintf(out,"datander -u");
+            j = i+BUNIT;
+            if (j > lblock+1)
+              j = lblock+1;
+            for (k = i; k < j; k++)
+              if (useblock)
+                if (usepath)
+                  fprintf(out," %s/%s.%d",pwd,root,k);
+                else
+                  fprintf(out," %s.%d",root,k);
+              else
+                if (usepath)
+                  fprintf(out," %s/%s",pwd,root);
+                else
+                  fprintf(out," %s",root);
+            fprintf(out,"\n");
+          }
+      }
+
     if (ONAME != NULL)
       fclose(out);
   }
 
   printf("# Once all the .tan masks have been computed for every block\n");
-  printf("#   you should call 'Catrack' to merge them, and then you should\n");
+  printf("#   you should call 'CATmask' (or 'Catrack') to merge them and\n");
   printf("#   remove the individual block tracks, e.g.:\n");
   if (usepath)
-    { printf("#      Catrack -v %s/%s %s\n",pwd,root,MASK_NAME);
-      printf("#      rm %s/.%s.*.%s.*\n",pwd,root,MASK_NAME);
-    }
+    printf("#      CATmask -vd %s/%s %s\n",pwd,root,MASK_NAME);
   else
-    { printf("#      Catrack -v %s %s\n",root,MASK_NAME);
-      printf("#      rm .%s.*.%s.*\n",root,MASK_NAME);
-    }
+    printf("#      CATmask -vd %s %s\n",root,MASK_NAME);
 
   free(root);
   free(pwd);
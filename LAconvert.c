@@ -0,0 +1,141 @@
+/*******************************************************************************************
+ *
+ *  LAconvert converts a classic .las file into the compact (version 2) format of align.h,
+ *    or a compact one back into the classic format, the direction being determined by the
+ *    format of the source.  The LAs, their order, and their traces are exactly preserved.
+ *
+ *  Author:  agent
+ *  Date  :  October 18, 2026
+ *
+ *******************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "DB.h"
+#include "align.h"
+
+static char *Usage = "[-v] <source:las> <target:las>";
+
+int main(int argc, char *argv[])
+{ FILE      *input, *output;
+  Las2_File *las;
+  Overlap    ovl;
+  int64      novl, j;
+  int        tspace, tbytes;
+  int        VERBOSE;
+  void      *trace;
+  int        tmax;
+
+  //  Process arguments
+
+  { int  i, j, k;
+    int  flags[128];
+
+    ARG_INIT("LAconvert")
+
+    j = 1;
+    for (i = 1; i < argc; i++)
+      if (argv[i][0] == '-')
+        switch (argv[i][1])
+        { default:
+            ARG_FLAGS("v")
+            break;
+        }
+      else
+        argv[j++] = argv[i];
+    argc = j;
+
+    VERBOSE = flags['v'];
+
+    if (argc != 3)
+      { fprintf(stderr,"Usage: %s %s\n",Prog_Name,Usage);
+        fprintf(stderr,"\n");
+        fprintf(stderr,"      -v: Verbose mode, output sizes of the files.\n");
+        exit (1);
+      }
+  }
+
+  input = Fopen(argv[1],"r");
+  if (input == NULL)
+    exit (1);
+  output = Fopen(argv[2],"w");
+  if (output == NULL)
+    exit (1);
+
+  tmax  = 0;
+  trace = NULL;
+  memset(&ovl,0,sizeof(Overlap));     //  So the padding of a classic record is written as 0
+
+  las = Open_Las2_Reader(input);
+
+  //  Compact to classic
+
+  if (las != NULL)
+    { novl   = las->novl;
+      tspace = las->tspace;
+      if (tspace <= TRACE_XOVR)
+        tbytes = sizeof(uint8);
+      else
+        tbytes = sizeof(uint16);
+
+      fwrite(&novl,sizeof(int64),1,output);
+      fwrite(&tspace,sizeof(int),1,output);
+
+      for (j = 0; j < novl; j++)
+        { if (Read_Overlap2(las,&ovl))
+            { fprintf(stderr,"%s: %s is truncated or corrupt\n",Prog_Name,argv[1]);
+              exit (1);
+            }
+          if (ovl.path.tlen > tmax)
+            { tmax  = 1.2*ovl.path.tlen + 100;
+              trace = Realloc(trace,tmax*sizeof(uint16),"Allocating trace vector");
+              if (trace == NULL)
+                exit (1);
+            }
+          ovl.path.trace = trace;
+          Read_Trace2(las,&ovl,tbytes);
+          if (Write_Overlap(output,&ovl,tbytes))
+            { fprintf(stderr,"%s: Write of %s failed\n",Prog_Name,argv[2]);
+              exit (1);
+            }
+        }
+
+      Close_Las2_Reader(las);
+    }
+
+  //  Classic to compact
+
+  else
+    { novl = Compact_Las(input,argv[1],output,argv[2]);
+      if (novl < 0)
+        exit (1);
+    }
+
+  fclose(input);
+  if (fclose(output) != 0)
+    { fprintf(stderr,"%s: Write of %s failed\n",Prog_Name,argv[2]);
+      exit (1);
+    }
+
+  if (VERBOSE)
+    { struct stat in, out;
+
+      stat(argv[1],&in);
+      stat(argv[2],&out);
+      printf("%s: ",argv[1]);
+      Print_Number(novl,0,stdout);
+      printf(" LAs, ");
+      Print_Number((int64) in.st_size,0,stdout);
+      printf(" bytes -> ");
+      Print_Number((int64) out.st_size,0,stdout);
+      printf(" bytes (%.2fx)\n",(1.*in.st_size)/out.st_size);
+    }
+
+  free(trace);
+  free(Prog_Name);
+
+  exit (0);
+}
@@ -0,0 +1,96 @@
+/*******************************************************************************************
+ *
+ *  LAindex builds the pile index (see pile.h) of each given sorted .las file, so that the
+ *    LAs of any read or range of reads can be found without scanning the file.  The index of
+ *    X.las is placed in the sidecar file X.las.idx.
+ *
+ *  Author:  agent
+ *  Date  :  October 18, 2026
+ *
+ *******************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "DB.h"
+#include "pile.h"
+
+static char *Usage = "[-v] <source:las> ...";
+
+int main(int argc, char *argv[])
+{ int VERBOSE;
+  int c;
+
+  //  Process arguments
+
+  { int  i, j, k;
+    int  flags[128];
+
+    ARG_INIT("LAindex")
+
+    j = 1;
+    for (i = 1; i < argc; i++)
+      if (argv[i][0] == '-')
+        switch (argv[i][1])
+        { default:
+            ARG_FLAGS("v")
+            break;
+        }
+      else
+        argv[j++] = argv[i];
+    argc = j;
+
+    VERBOSE = flags['v'];
+
+    if (argc < 2)
+      { fprintf(stderr,"Usage: %s %s\n",Prog_Name,Usage);
+        fprintf(stderr,"\n");
+        fprintf(stderr,"      -v: Verbose mode, output the reads and LAs of each file.\n");
+        exit (1);
+      }
+  }
+
+  //  Index each .las file, or each block .las file if a block argument
+
+  for (c = 1; c < argc; c++)
+    { Block_Looper *parse;
+      Las_Index    *index;
+      FILE         *input;
+      char         *path, *root, *name;
+
+      parse = Parse_Block_LAS_Arg(argv[c]);
+
+      while ((input = Next_Block_Arg(parse)) != NULL)
+        { path = Block_Arg_Path(parse);
+          root = Block_Arg_Root(parse);
+          name = Strdup(Catenate(path,"/",root,".las"),"Allocating file name");
+          if (name == NULL)
+            exit (1);
+
+          index = Build_Las_Index(input,name);
+          if (index == NULL)
+            exit (1);
+          if (Write_Las_Index(index,name))
+            exit (1);
+
+          if (VERBOSE)
+            { printf("%s: ",name);
+              Print_Number(index->novl,0,stdout);
+              printf(" LAs for reads %d to %d\n",index->first+1,index->last);
+            }
+
+          Free_Las_Index(index);
+          fclose(input);
+          free(name);
+          free(root);
+          free(path);
+        }
+
+      Free_Block_Arg(parse);
+    }
+
+  free(Prog_Name);
+
+  exit (0);
+}
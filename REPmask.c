@@ -12,9 +12,16 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 #include "DB.h"
 #include "align.h"
+#include "pile.h"
+#include "track.h"
 
 #ifdef HIDE_FILES
 #define PATHSEP "/."
@@ -22,7 +29,9 @@
 #define PATHSEP "/"
 #endif
 
-static char *Usage = "[-v] [-n<track(rep)] -c<int> <source:db> <overlaps:las> ...";
+static char *Usage =
+          "[-vm] [-n<track(rep)] [-T<int(4)>] [-p<int(250000)>]\n"
+          "             -c<int>[,<int>]* <source:db> <overlaps:las> ...";
 
 #undef   DEBUG_BLOCKS
 #undef   DEBUG_GAP_MERGE
@@ -40,25 +49,27 @@ static char *Usage = "[-v] [-n<track(rep)] -c<int> <source:db> <overlaps:las> ..
 //  Global Data Structures
 
 static int VERBOSE;
-static int MIN_COVER;
+static int MERGE;                 //  Each .las argument is the block-pair files of an A-block
+static int NCOVER;                //  # of coverage thresholds
+static int *MIN_COVER;            //  The thresholds, a mask track is made for each
+static int NTHREADS;
+static int PILE_CAP;              //  Piles with more LAs than this are streamed (see GIANT)
 
 static DAZZ_DB   _DB, *DB = &_DB;     //  Data base
 static int        DB_FIRST;           //  First read of DB to process
 static int        DB_LAST;            //  Last read of DB to process (+1)
 static int        DB_PART;            //  0 if all, otherwise block #
-static DAZZ_READ *Reads;              //  Data base reads array
+static uint64    *Well_Start;         //  Bit j is set if read j of the trimmed DB starts a well
+static int        Well_Reads;         //  # of reads in the trimmed DB
+static int64     *Well_Map;           //  Memory map of the .wells sidecar Well_Start is in
+static int64      Well_Size;          //    (if not NULL) and its size
 
-static int TRACE_SPACING;         //  Trace spacing (from .las file)
-static int TBYTES;                //  Bytes per trace segment (from .las file)
-
-static FILE   *MSK_AFILE;         //  .rep.anno
-static FILE   *MSK_DFILE;         //  .rep.data
-static int64   MSK_INDEX;         //  Current index into .rep.data file as it is being written
+static Track_Writer **MSK_TRACK;  //  .rep.anno & .rep.data for each threshold
 
 //  Statistics
 
 static int64 nreads, totlen;
-static int64 nmasks, masked;
+static int64 ngiant;
 
 
 /*******************************************************************************************
@@ -71,102 +82,212 @@ static int64 nmasks, masked;
  *
  *******************************************************************************************/
 
+  //  An event is packed into an unsigned int as pos << 1 | add so that sorting the keys orders
+  //    events by position and ends before starts at the same position.  They are sorted with
+  //    an LSD radix sort on as many bytes as the largest key needs, and then collapsed into
+  //    steps, the # of ends and starts at each position.  For a pile too large to hold (see
+  //    GIANT) the steps are instead tallied in a vector over the positions of the A-read.
+
+typedef struct
+  { int pos;
+    int ndel, nadd;
+  } Step;
+
+  //  Each thread partitions a contiguous range of the piles of a batch, [rbeg,rend), using its
+  //    own work vectors, and appends the intervals found for each coverage threshold to the
+  //    data vector out[t] of that threshold.  The # of interval ends found for read j is
+  //    out[t].ints[j-rbeg].
+
+typedef struct
+  { int      dmax;         //  Interval ends found, data[0..dtop)
+    int      dtop;
+    int     *data;
+    int     *ints;
+    int64    nmasks, masked;
+  } Partition_Out;
+
 typedef struct
-  { int add;
-    int pos;
-  } Event;
+  { int      rbeg, rend;   //  Reads of the batch to process
+    int      nmax;         //  Event keys and radix sort buffer, 2*nmax each
+    uint32  *ev;
+    int      smax;         //  Work vectors for blocks, steps has smax entries, trim and flim
+    Step    *steps;        //    2*smax each
+    int     *trim;
+    int     *flim;
+    int      cmax;         //  Step tallies of a giant pile, 2*cmax ints
+    int     *tally;
+    int      omax;         //  LAs of a giant pile not yet partitioned
+    Overlap *ovls;
+    int      imax;         //  Size of the ints vectors of out
+    Partition_Out *out;    //  out[0..NCOVER)
+    int64    nreads, totlen;
+  } Partition_Arg;
+
+static uint32 *radix_sort(uint32 *key, uint32 *tmp, int n, uint32 kmax)
+{ int     count[256];
+  int     i, c, t, shift;
+  uint32 *x;
+
+  for (shift = 0; (kmax >> shift) != 0; shift += 8)
+    { memset(count,0,sizeof(int)*256);
+      for (i = 0; i < n; i++)
+        count[(key[i] >> shift) & 0xff] += 1;
+      t = 0;
+      for (c = 0; c < 256; c++)
+        { i = count[c];
+          count[c] = t;
+          t += i;
+        }
+      for (i = 0; i < n; i++)
+        tmp[count[(key[i] >> shift) & 0xff]++] = key[i];
+      x   = key;
+      key = tmp;
+      tmp = x;
+    }
+  return (key);
+}
+
+  //  Make sure parm has room for n steps
+
+static Step *step_room(int n, Partition_Arg *parm)
+{ if (n > parm->smax)
+    { parm->smax  = n*1.2 + 1000;
+      parm->steps = (Step *) Realloc(parm->steps,sizeof(Step)*parm->smax,
+                                     "Reallocating step vector");
+      parm->trim  = (int *) Realloc(parm->trim,sizeof(int)*4*parm->smax,
+                                    "Reallocating trim vector");
+      if (parm->steps == NULL || parm->trim == NULL)
+        exit (1);
+      parm->flim = parm->trim + 2*parm->smax;
+    }
+  return (parm->steps);
+}
 
-static int EVENT_SORT(const void *l, const void *r)
-{ Event *x = ((Event *) l);
-  Event *y = ((Event *) r);
+  //  The peeled back alignment interval of an LA that contributes coverage
 
-  if (x->pos != y->pos)
-    return (x->pos - y->pos);
-  return (x->add - y->add);
+#define PEELED(o,ab,ae)						\
+{ ab = (o)->path.abpos+PEEL_BACK;				\
+  ae = (o)->path.aepos-PEEL_BACK;				\
+  if (ae < ab)							\
+    ab = ae = ((o)->path.abpos + (o)->path.aepos)/2;		\
 }
 
-static int *blocks(Overlap *ovls, int novl, int *ptrim)
-{ static int    nmax = 0;
-  static Event *ev = NULL;
-  static int   *trim = NULL;
-  static int   *flim;
+  //  Set up and sort the event queue of a pile, returning its steps (*pnst of them)
 
-  int ecnt, ntrim;
+static Step *sort_events(Overlap *ovls, int novl, int *pnst, Partition_Arg *parm)
+{ uint32 *ev;
+  Step   *st;
+  int     ecnt, nst;
 
-  if (novl > nmax)
-    { nmax = novl*1.2 + 1000; 
-      ev    = (Event *) Realloc(ev,sizeof(Event)*2*nmax,"Reallocating event vector");
-      trim  = (int *) Realloc(trim,sizeof(int)*4*nmax,"Reallocating trim vector");
-      flim  = trim + 2*nmax;
+  if (novl > parm->nmax)
+    { parm->nmax = novl*1.2 + 1000; 
+      parm->ev   = (uint32 *) Realloc(parm->ev,sizeof(uint32)*4*parm->nmax,
+                                      "Reallocating event vector");
+      if (parm->ev == NULL)
+        exit (1);
     }
- 
-  //  Set up and sort event queue
+  ev = parm->ev;
 
-  { int i, ab, ae;
+  { int    i, ab, ae;
+    uint32 kmax;
 
     ecnt = 0;
+    kmax = 0;
     for (i = 0; i < novl; i++)
-      { ab = ovls[i].path.abpos+PEEL_BACK;
-        ae = ovls[i].path.aepos-PEEL_BACK;
-
-        if (ae < ab) 
-          ab = ae = (ovls[i].path.abpos + ovls[i].path.aepos)/2;
-
-        ev[ecnt].add = 1;
-        ev[ecnt].pos = ab;
-        ecnt += 1;
-        ev[ecnt].add = 0;
-        ev[ecnt].pos = ae;
-        ecnt += 1;
+      { PEELED(ovls+i,ab,ae)
+
+        ev[ecnt++] = (((uint32) ab) << 1) | 1;
+        ev[ecnt++] = (((uint32) ae) << 1);
+        if (ev[ecnt-2] > kmax)
+          kmax = ev[ecnt-2];
+        if (ev[ecnt-1] > kmax)
+          kmax = ev[ecnt-1];
       }
 
-    qsort(ev,ecnt,sizeof(Event),EVENT_SORT);
+    ev = radix_sort(ev,ev+2*parm->nmax,ecnt,kmax);
   }
 
+  st = step_room(ecnt,parm);
+
+  { int i, pos;
+
+    nst = 0;
+    for (i = 0; i < ecnt; i++)
+      { pos = (int) (ev[i] >> 1);
+        if (nst == 0 || st[nst-1].pos != pos)
+          { st[nst].pos  = pos;
+            st[nst].ndel = 0;
+            st[nst].nadd = 0;
+            nst += 1;
+          }
+        if (ev[i] & 1)
+          st[nst-1].nadd += 1;
+        else
+          st[nst-1].ndel += 1;
+      }
+  }
+
+  *pnst = nst;
+  return (st);
+}
+
+  //  Find the high-coverage intervals of the steps st[0..nst) for coverage threshold cover,
+  //    returning them in parm->trim[0..*ptrim).
+
+static int *blocks(Step *st, int nst, int cover, int *ptrim, Partition_Arg *parm)
+{ int *trim, *flim;
+  int  ntrim;
+
+  trim = parm->trim;
+  flim = parm->flim;
+
   //  Compute in - out intervals (over the contracted alignment intervals) with respect to
-  //    coverage depth threshold MIN_COVER and also the max (in interavls) or min (out intervals)
-  //    coverage.
+  //    coverage depth threshold cover and also the max (in interavls) or min (out intervals)
+  //    coverage.  The ends at a position are taken before the starts, and the coverage
+  //    crosses cover at most once for each.
 
-  { int i;
+  { int i, pos;
     int cov, min, max;
 
     ntrim = 0;
     cov   = 0;
     min   = 0;
     max   = 0;
-    for (i = 0; i < ecnt; i++)
-      if (ev[i].add)
-        { cov += 1;
-          if (cov > max)
-            max = cov;
-          if (cov == MIN_COVER) 
-            { trim[ntrim]   = ev[i].pos-PEEL_BACK;
-              flim[ntrim++] = min;
-              max = MIN_COVER;
+    for (i = 0; i < nst; i++)
+      { pos = st[i].pos;
+        if (st[i].ndel > 0)
+          { if (cov >= cover && cov - st[i].ndel < cover)
+              { trim[ntrim]   = pos+PEEL_BACK;
+                flim[ntrim++] = max;
+                min = cover;
 #ifdef DEBUG_BLOCKS
-              printf("    In %4d\n",ev[i].pos-PEEL_BACK);
+                printf("    Out %4d\n",pos+PEEL_BACK);
 #endif
-            }
+              }
+            cov -= st[i].ndel;
+            if (cov < min)
+              min = cov;
 #ifdef DEBUG_BLOCKS
-          printf("  Add %4d (%3d)\n",ev[i].pos,cov);
+            printf("  Del %4d (%3d)\n",pos,cov);
 #endif
-        }
-      else
-        { if (cov == MIN_COVER)
-            { trim[ntrim]   = ev[i].pos+PEEL_BACK;
-              flim[ntrim++] = max;
-              min = MIN_COVER;
+          }
+        if (st[i].nadd > 0)
+          { if (cov < cover && cov + st[i].nadd >= cover)
+              { trim[ntrim]   = pos-PEEL_BACK;
+                flim[ntrim++] = min;
+                max = cover;
 #ifdef DEBUG_BLOCKS
-              printf("    Out %4d\n",ev[i].pos+PEEL_BACK);
+                printf("    In %4d\n",pos-PEEL_BACK);
 #endif
-            }
-          cov -= 1;
-          if (cov < min)
-            min = cov;
+              }
+            cov += st[i].nadd;
+            if (cov > max)
+              max = cov;
 #ifdef DEBUG_BLOCKS
-          printf("  Del %4d (%3d)\n",ev[i].pos,cov);
+            printf("  Add %4d (%3d)\n",pos,cov);
 #endif
-        }
+          }
+      }
   }
 
   //  Merge intervals that overlap by more than 20bp and have a small "hill" to either
@@ -216,22 +337,211 @@ static int *blocks(Overlap *ovls, int novl, int *ptrim)
 
 /*******************************************************************************************
  *
- *  FORMULATE POSSIBLE REPEAT INTERVALS
+ *  WELL INDEX:
+ *    Only the reads of the block being masked are loaded, so the wells of the B-reads are
+ *    given by a bit vector over the whole trimmed DB.  It is built with one pass over the
+ *    DB's .idx file by the first job to need it and saved in the sidecar file .DB.wells,
+ *    which every later job then simply maps.
  *
  *******************************************************************************************/
 
-static void PARTITION(int aread, Overlap *ovls, int novl)
-{ int   ntrim, *trim;
+#define IDX_CHUNK  0x10000     //  # of read records read from the .idx file at a time
 
-#if defined(DEBUG_BLOCKS) || defined(DEBUG_GAP_MERGE)
-  printf("\nAREAD %d (%d)\n",aread,DB->reads[aread].rlen);
-#endif
+  //  The sidecar is WELL_HEAD int64's: the ureads and totlen of the DB, the trimming cutoff
+  //    and read selection it was built for, and Well_Reads, followed by the bit vector.
 
-  if (novl <= 0)
-    { fwrite(&MSK_INDEX,sizeof(int64),1,MSK_AFILE);
+#define WELL_HEAD  5
+
+static int well_words(DAZZ_DB *header)
+{ return (header->ureads/64+1); }
+
+  //  Map the sidecar of db if there is one that matches header and the trimming of db
+
+static int map_wells(DAZZ_DB *db, DAZZ_DB *header, int allflag)
+{ struct stat info;
+  int64      *map, size;
+  int         fd;
+
+  fd = open(Catenate(db->path,"","",".wells"),O_RDONLY);
+  if (fd < 0)
+    return (1);
+  size = sizeof(int64)*(WELL_HEAD + well_words(header));
+  if (fstat(fd,&info) < 0 || info.st_size != size)
+    { close(fd);
+      return (1);
+    }
+  map = (int64 *) mmap(NULL,size,PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return (1);
+  if (map[0] != header->ureads || map[1] != header->totlen
+                               || map[2] != db->cutoff || map[3] != allflag)
+    { munmap(map,size);
+      return (1);
+    }
+  Well_Map   = map;
+  Well_Size  = size;
+  Well_Reads = map[4];
+  Well_Start = (uint64 *) (map + WELL_HEAD);
+  return (0);
+}
+
+  //  Save Well_Start as the sidecar of db.  It is written under a name private to this
+  //    process and then renamed so that a job never maps a partly written sidecar.  Failure
+  //    is not an error, the next job just builds the vector again.
+
+static void save_wells(DAZZ_DB *db, DAZZ_DB *header, int allflag)
+{ FILE  *output;
+  char  *name, *temp;
+  int64  head[WELL_HEAD];
+  int    nw, ok;
+
+  name = Strdup(Catenate(db->path,"","",".wells"),"Allocating sidecar name");
+  if (name == NULL)
+    return;
+  temp = Strdup(Catenate(name,Numbered_Suffix(".",getpid(),""),"",""),"Allocating sidecar name");
+  if (temp == NULL)
+    { free(name);
       return;
     }
 
+  head[0] = header->ureads;
+  head[1] = header->totlen;
+  head[2] = db->cutoff;
+  head[3] = allflag;
+  head[4] = Well_Reads;
+  nw      = well_words(header);
+
+  output = fopen(temp,"w");
+  if (output != NULL)
+    { ok = (fwrite(head,sizeof(int64),WELL_HEAD,output) == WELL_HEAD
+            && fwrite(Well_Start,sizeof(uint64),nw,output) == (size_t) nw);
+      if (fclose(output) != 0 || ! ok || rename(temp,name) != 0)
+        unlink(temp);
+    }
+
+  free(temp);
+  free(name);
+}
+
+  //  Set Well_Start for the trimmed DB of db, which must be opened but not yet trimmed.
+  //    A trimmed read starts a well unless an earlier read of its well is also kept, as
+  //    in Trim_DB.
+
+static void build_wells(DAZZ_DB *db)
+{ FILE      *index;
+  DAZZ_DB    header;
+  DAZZ_READ *reads;
+  int        allflag, cutoff, trim;
+  int        i, j, n, m, css, f;
+
+  index = Fopen(Catenate(db->path,"","",".idx"),"r");
+  if (index == NULL)
+    exit (1);
+  if (fread(&header,sizeof(DAZZ_DB),1,index) != 1)
+    SYSTEM_READ_ERROR
+
+  trim   = (db->cutoff > 0 || (db->allarr & DB_ALL) == 0);
+  cutoff = db->cutoff;
+  if ((db->allarr & DB_ALL) != 0)
+    allflag = 0;
+  else
+    allflag = DB_BEST;
+
+  if (map_wells(db,&header,allflag) == 0)
+    { fclose(index);
+      return;
+    }
+
+  reads      = (DAZZ_READ *) Malloc(sizeof(DAZZ_READ)*IDX_CHUNK,"Allocating index buffer");
+  Well_Start = (uint64 *) Malloc(sizeof(uint64)*well_words(&header),"Allocating well index");
+  if (reads == NULL || Well_Start == NULL)
+    exit (1);
+  memset(Well_Start,0,sizeof(uint64)*well_words(&header));
+
+  css = 0;
+  j   = 0;
+  for (i = 0; i < header.ureads; i += n)
+    { n = header.ureads - i;
+      if (n > IDX_CHUNK)
+        n = IDX_CHUNK;
+      if (fread(reads,sizeof(DAZZ_READ),n,index) != (size_t) n)
+        SYSTEM_READ_ERROR
+      for (m = 0; m < n; m++)
+        { f = reads[m].flags;
+          if ( ! trim)
+            { if ((f & DB_CCS) == 0)
+                Well_Start[j>>6] |= (1llu << (j&0x3f));
+              j += 1;
+              continue;
+            }
+          if ((f & DB_CCS) == 0)
+            css = 0;
+          if ((f & DB_BEST) >= allflag && reads[m].rlen >= cutoff)
+            { if ( ! css)
+                Well_Start[j>>6] |= (1llu << (j&0x3f));
+              j += 1;
+              css = 1;
+            }
+        }
+    }
+  Well_Reads = j;
+
+  free(reads);
+  fclose(index);
+
+  save_wells(db,&header,allflag);
+}
+
+  //  First read of the well containing read j (-1 if the DB starts mid-well)
+
+static int well_beg(int j)
+{ uint64 x;
+  int    w;
+
+  w = (j >> 6);
+  x = Well_Start[w] & ((2llu << (j&0x3f)) - 1);
+  while (x == 0)
+    { if (w == 0)
+        return (-1);
+      x = Well_Start[--w];
+    }
+  return ((w << 6) + 63 - __builtin_clzll(x));
+}
+
+  //  First read after j that starts a new well (Well_Reads if none)
+
+static int well_end(int j)
+{ uint64 x;
+  int    w, wend;
+
+  j += 1;
+  if (j >= Well_Reads)
+    return (Well_Reads);
+  w    = (j >> 6);
+  wend = ((Well_Reads-1) >> 6);
+  x    = Well_Start[w] >> (j&0x3f);
+  if (x != 0)
+    return (j + __builtin_ctzll(x));
+  while (++w <= wend)
+    if (Well_Start[w] != 0)
+      return ((w << 6) + __builtin_ctzll(Well_Start[w]));
+  return (Well_Reads);
+}
+
+
+/*******************************************************************************************
+ *
+ *  FORMULATE POSSIBLE REPEAT INTERVALS
+ *
+ *******************************************************************************************/
+
+  //  Merge the LAs of ovls[0..novl) that appear to have a low-quality induced gap between
+  //    them and then keep only those of the best read of each well, returning the # kept.
+  //    Both steps only look within the LAs of a well so a pile can be taken a well at a time.
+
+static int select_las(int aread, Overlap *ovls, int novl)
+{
   //  Merge overlap pairs that appear to have a low-quality induced gap between them
 
   { int   i, j, k;
@@ -292,7 +602,7 @@ static void PARTITION(int aread, Overlap *ovls, int novl)
 
   { int   i, j, k, t;
     int   bread, lread, cssr;
-    int   DBreads, alow, ahigh;
+    int   alow, ahigh;
     Path *ipath;
     int   best, score;
     int   bnbeg, snbeg;
@@ -300,41 +610,24 @@ static void PARTITION(int aread, Overlap *ovls, int novl)
     int   multi;
 #endif
 
-    DBreads = DB->nreads;
-    for (j = aread+1; j < DBreads; j++)
-      if ((Reads[j].flags & DB_CCS) == 0)
-        break;
-    ahigh = j;
-    for (j = aread; j >= 0; j--)
-      if ((Reads[j].flags & DB_CCS) == 0)
-        break;
-    alow = j;
+    ahigh = well_end(aread);
+    alow  = well_beg(aread);
 
     k = 0;
     for (i = 0; i < novl; i = j)
       { bread = ovls[i].bread;
 
         if (alow <= bread && bread < ahigh)
-          { j += 1;
+          { j = i+1;
             continue;
           }
 
-        for (j = bread+1; j < DBreads; j++)
-          if ((Reads[j].flags & DB_CCS) == 0)
-            break;
-        cssr = j;
+        cssr = well_end(bread);
 
 #ifdef DEBUG_WELL_SELECTION
         multi = (cssr-bread > 1);
         if (multi)
-          { printf(" CLUSTER: %d - %d:",bread,cssr);
-            for (j = bread+1; j < cssr; j++)
-              { printf(" %d",Reads[j].fpulse - (Reads[j-1].fpulse+Reads[j-1].rlen));
-                if (Reads[j].fpulse - (Reads[j-1].fpulse+Reads[j-1].rlen) > 60)
-                  printf(" XXX");
-              }
-            printf(" (%d)\n",Reads[bread].origin);
-          }
+          printf(" CLUSTER: %d - %d\n",bread,cssr);
 #endif
 
         lread = -1;
@@ -382,158 +675,218 @@ static void PARTITION(int aread, Overlap *ovls, int novl)
     novl = k;
   }
 
-  //  Find the high-coverage intervals over the pair-merged alignment intervals
+  return (novl);
+}
 
-  trim = blocks(ovls,novl,&ntrim);
+  //  Record the high-coverage intervals for each threshold of the steps st[0..nst) of aread
 
-  if (VERBOSE)
-    { int i;
+static void record_blocks(Partition_Arg *parm, int aread, Step *st, int nst)
+{ int t;
+
+  for (t = 0; t < NCOVER; t++)
+    { Partition_Out *out = parm->out + t;
+      int            ntrim, *trim;
+
+      trim = blocks(st,nst,MIN_COVER[t],&ntrim,parm);
+
+      if (VERBOSE)
+        { int i;
+
+          for (i = 0; i < ntrim; i += 2)
+            out->masked += trim[i+1]-trim[i];
+          out->nmasks += ntrim/2;
+        }
 
-      for (i = 0; i < ntrim; i += 2)
-        masked += trim[i+1]-trim[i];
-      nmasks += ntrim/2;
-      nreads += 1;
-      totlen += DB->reads[aread].rlen;
+      if (out->dtop + ntrim > out->dmax)
+        { out->dmax = 1.2*(out->dtop+ntrim) + 10000;
+          out->data = (int *) Realloc(out->data,sizeof(int)*out->dmax,
+                                      "Reallocating interval vector");
+          if (out->data == NULL)
+            exit (1);
+        }
+      memcpy(out->data+out->dtop,trim,sizeof(int)*ntrim);
+      out->dtop += ntrim;
+      out->ints[aread-parm->rbeg] = ntrim;
     }
+}
 
-  //  Write out the trim intervals for the read
+static void PARTITION(void *arg, int aread, Overlap *ovls, int novl)
+{ Partition_Arg *parm = (Partition_Arg *) arg;
+  Step *st;
+  int   nst;
 
-  { int i;
+#if defined(DEBUG_BLOCKS) || defined(DEBUG_GAP_MERGE)
+  printf("\nAREAD %d (%d)\n",aread,DB->reads[aread-DB_FIRST].rlen);
+#endif
 
-    for (i = 0; i < ntrim; i += 2)
-      { fwrite(trim+i,sizeof(int),1,MSK_DFILE);
-        fwrite(trim+(i+1),sizeof(int),1,MSK_DFILE);
-      }
-    MSK_INDEX += ntrim*sizeof(int);
-    fwrite(&MSK_INDEX,sizeof(int64),1,MSK_AFILE);
-  }
+  if (novl <= 0)
+    { int t;
+
+      for (t = 0; t < NCOVER; t++)
+        parm->out[t].ints[aread-parm->rbeg] = 0;
+      return;
+    }
+
+  novl = select_las(aread,ovls,novl);
+
+  if (VERBOSE)
+    { parm->nreads += 1;
+      parm->totlen += DB->reads[aread-DB_FIRST].rlen;
+    }
+
+  //  Find the high-coverage intervals over the pair-merged alignment intervals for each
+  //    threshold (the events are sorted once for all of them) and record them for the read
+
+  st = sort_events(ovls,novl,&nst,parm);
+  record_blocks(parm,aread,st,nst);
 }
 
+  //  Partition the pile of aread, which has too many LAs to hold, as it is streamed from
+  //    piles PART_OVLS LAs at a time.  The LAs of all but the last well seen are selected and
+  //    their events tallied in a vector over the positions of aread, and those of the last
+  //    well are held back until it is complete.  The memory used is thus proportional to the
+  //    length of aread and the size of the largest well group of the pile.
+
+#define PART_OVLS  100000
 
-  //  Read in each successive pile and call ACTION on it.  Read in the traces only if
-  //   "trace" is nonzero
+static void GIANT(void *arg, int aread, Las_Piles *piles)
+{ Partition_Arg *parm = (Partition_Arg *) arg;
+  int  rlen = DB->reads[aread-DB_FIRST].rlen;
+  int *nadd, *ndel;
+  int  n, m, e;
 
-static int make_a_pass(FILE *input, void (*ACTION)(int, Overlap *, int), int trace)
-{ static Overlap *ovls = NULL;
-  static int      omax = 500;
-  static uint16  *paths = NULL;
-  static int      pmax = 100000;
+#if defined(DEBUG_BLOCKS) || defined(DEBUG_GAP_MERGE)
+  printf("\nAREAD %d (%d)\n",aread,rlen);
+#endif
 
-  int64 i, j, novl;
-  int   n, a;
-  int   pcur;
-  int   max;
+  ngiant += 1;
 
-  if (ovls == NULL)
-    { ovls = (Overlap *) Malloc(sizeof(Overlap)*omax,"Allocating overlap buffer");
-      if (ovls == NULL)
+  if (rlen >= parm->cmax)
+    { parm->cmax  = 1.2*rlen + 1000;
+      parm->tally = (int *) Realloc(parm->tally,sizeof(int)*2*parm->cmax,
+                                    "Reallocating tally vector");
+      if (parm->tally == NULL)
         exit (1);
     }
-  if (trace && paths == NULL)
-    { paths = (uint16 *) Malloc(sizeof(uint16)*pmax,"Allocating path buffer");
-      if (paths == NULL)
+  nadd = parm->tally;
+  ndel = parm->tally + parm->cmax;
+  memset(nadd,0,sizeof(int)*(rlen+1));
+  memset(ndel,0,sizeof(int)*(rlen+1));
+
+  n = 0;
+  do
+    { if (n + PART_OVLS > parm->omax)
+        { parm->omax = 1.2*(n+PART_OVLS) + 1000;
+          parm->ovls = (Overlap *) Realloc(parm->ovls,sizeof(Overlap)*parm->omax,
+                                           "Reallocating overlap buffer");
+          if (parm->ovls == NULL)
+            exit (1);
+        }
+      m = Next_Pile_Part(piles,aread,PART_OVLS);
+      if (m < 0)
         exit (1);
-    }
+      memcpy(parm->ovls+n,piles->ovls,sizeof(Overlap)*m);
+      n += m;
 
-  rewind(input);
-  fread(&novl,sizeof(int64),1,input);
-  fread(&TRACE_SPACING,sizeof(int),1,input);
-  if (TRACE_SPACING <= TRACE_XOVR)
-    TBYTES = sizeof(uint8);
-  else
-    TBYTES = sizeof(uint16);
-
-  if (Read_Overlap(input,ovls) != 0)
-    ovls[0].aread = INT32_MAX;
-  else if (trace)
-    { if (ovls[0].path.tlen > pmax)
-        { pmax  = 1.2*(ovls[0].path.tlen)+10000;
-          paths = (uint16 *) Realloc(paths,sizeof(uint16)*pmax,"Expanding path buffer");
-          if (paths == NULL) exit (1);
+      e = n;
+      if (m > 0)
+        { int wb = well_beg(parm->ovls[n-1].bread);
+
+          while (e > 0 && parm->ovls[e-1].bread >= wb)
+            e -= 1;
         }
-      fread(paths,TBYTES,ovls[0].path.tlen,input);
-      if (TBYTES == 1)
-        { ovls[0].path.trace = paths;
-          Decompress_TraceTo16(ovls);
+
+      if (e > 0)
+        { int i, k, ab, ae;
+
+          k = select_las(aread,parm->ovls,e);
+          for (i = 0; i < k; i++)
+            { PEELED(parm->ovls+i,ab,ae)
+              nadd[ab] += 1;
+              ndel[ae] += 1;
+            }
+          memmove(parm->ovls,parm->ovls+e,sizeof(Overlap)*(n-e));
+          n -= e;
         }
     }
-  else
-    fseek(input,TBYTES*ovls[0].path.tlen,SEEK_CUR);
+  while (m > 0);
 
-  if (ovls[0].aread < DB_FIRST)
-    { fprintf(stderr,"%s: .las file overlaps don't correspond to reads in block %d of DB\n",
-                     Prog_Name,DB_PART);
-      exit (1);
+  if (VERBOSE)
+    { parm->nreads += 1;
+      parm->totlen += rlen;
     }
 
-  pcur = 0;
-  n = max = 0;
-  for (j = DB_FIRST; j < DB_LAST; j++)
-    { ovls[0] = ovls[n];
-      a = ovls[0].aread;
-      if (a != j)
-        n = 0;
-      else
-        { if (trace)
-            memmove(paths,paths+pcur,sizeof(uint16)*ovls[0].path.tlen);
-          n = 1;
-          pcur = ovls[0].path.tlen;
-          while (1)
-            { if (Read_Overlap(input,ovls+n) != 0)
-                { ovls[n].aread = INT32_MAX;
-                  break;
-                }
-              if (trace)
-                { if (pcur + ovls[n].path.tlen > pmax)
-                    { pmax = 1.2*(pcur+ovls[n].path.tlen)+10000;
-                      paths = (uint16 *) Realloc(paths,sizeof(uint16)*pmax,"Expanding path buffer");
-                      if (paths == NULL) exit (1);
-                    }
-                  fread(paths+pcur,TBYTES,ovls[n].path.tlen,input);
-                  if (TBYTES == 1)
-                    { ovls[n].path.trace = paths+pcur;
-                      Decompress_TraceTo16(ovls+n);
-                    }
-                }
-              else
-                fseek(input,TBYTES*ovls[n].path.tlen,SEEK_CUR);
-              if (ovls[n].aread != a)
-                break;
-              pcur += ovls[n].path.tlen;
-              n    += 1;
-              if (n >= omax)
-                { omax = 1.2*n + 100;
-                  ovls = (Overlap *) Realloc(ovls,sizeof(Overlap)*omax,"Expanding overlap buffer");
-                  if (ovls == NULL) exit (1);
-                }
-            }
+  { Step *st;
+    int   i, nst;
+
+    nst = 0;
+    for (i = 0; i <= rlen; i++)
+      if (nadd[i] > 0 || ndel[i] > 0)
+        nst += 1;
+    st = step_room(nst,parm);
+    nst = 0;
+    for (i = 0; i <= rlen; i++)
+      if (nadd[i] > 0 || ndel[i] > 0)
+        { st[nst].pos  = i;
+          st[nst].ndel = ndel[i];
+          st[nst].nadd = nadd[i];
+          nst += 1;
+        }
+    record_blocks(parm,aread,st,nst);
+  }
+}
 
-          if (n >= max)
-            max = n;
-          pcur = 0;
-          for (i = 0; i < n; i++)
-            { ovls[i].path.trace = paths+pcur;
-              pcur += ovls[i].path.tlen;
-            }
+  //  Set up parm to partition the piles of reads [rbeg,rend)
+
+static void START(void *arg, int rbeg, int rend)
+{ Partition_Arg *parm = (Partition_Arg *) arg;
+  int            t;
+
+  parm->rbeg = rbeg;
+  parm->rend = rend;
+  if (rend - rbeg > parm->imax)
+    { parm->imax = 1.2*(rend-rbeg) + 1000;
+      for (t = 0; t < NCOVER; t++)
+        { parm->out[t].ints = (int *) Realloc(parm->out[t].ints,sizeof(int)*parm->imax,
+                                              "Expanding pile index");
+          if (parm->out[t].ints == NULL)
+            exit (1);
         }
-      ACTION(j,ovls,n);
     }
+  for (t = 0; t < NCOVER; t++)
+    parm->out[t].dtop = 0;
+}
 
-  if (ovls[n].aread < INT32_MAX)
-    { fprintf(stderr,"%s: .las file overlaps don't correspond to reads in block %d of DB\n",
-                     Prog_Name,DB_PART);
-      exit (1);
-    }
+  //  Write the intervals found by parm to the track files in read order
 
-  return (max);
+static void FINISH(void *arg)
+{ Partition_Arg *parm = (Partition_Arg *) arg;
+  int            j, t, d, n;
+
+  for (t = 0; t < NCOVER; t++)
+    { Partition_Out *out = parm->out + t;
+
+      d = 0;
+      for (j = parm->rbeg; j < parm->rend; j++)
+        { n = out->ints[j-parm->rbeg];
+          Add_Track_Read(MSK_TRACK[t],out->data+d,n);
+          d += n;
+        }
+    }
 }
 
+  //  The piles of the .las files are gathered in batches of at least BATCH_OVLS LAs
+
+#define BATCH_OVLS  250000
+
 int main(int argc, char *argv[])
 { char  *root, *dpwd;
   int    status;
-  int64  novl;
-  int    c;
+  Partition_Arg *parm;
+  Pile_Pass      pass;
+  int    c, t;
   char  *MASK_NAME;
+  char **TRACK;
 
   //  Process arguments
 
@@ -543,56 +896,159 @@ int main(int argc, char *argv[])
 
     ARG_INIT("REPmask")
 
-    MIN_COVER = -1;
+    NCOVER    = 0;
     MASK_NAME = "rep";
+    NTHREADS  = 4;
+    PILE_CAP  = 250000;
 
     j = 1;
     for (i = 1; i < argc; i++)
       if (argv[i][0] == '-')
         switch (argv[i][1])
         { default:
-            ARG_FLAGS("v")
+            ARG_FLAGS("vm")
             break;
           case 'c':
-            ARG_POSITIVE(MIN_COVER,"Repeat coverage threshold")
+            { char *p = argv[i]+2;
+
+              free(MIN_COVER);
+              MIN_COVER = (int *) Malloc(sizeof(int)*(strlen(p)/2+1),"Allocating thresholds");
+              if (MIN_COVER == NULL)
+                exit (1);
+              NCOVER = 0;
+              do
+                { MIN_COVER[NCOVER] = strtol(p,&eptr,10);
+                  if (eptr == p || (*eptr != ',' && *eptr != '\0') || MIN_COVER[NCOVER] <= 0)
+                    { fprintf(stderr,"%s: -c '%s' argument is not a list of positive integers\n",
+                                     Prog_Name,argv[i]+2);
+                      exit (1);
+                    }
+                  for (k = 0; k < NCOVER; k++)
+                    if (MIN_COVER[k] == MIN_COVER[NCOVER])
+                      { fprintf(stderr,"%s: Repeat coverage threshold %d given twice\n",
+                                       Prog_Name,MIN_COVER[k]);
+                        exit (1);
+                      }
+                  NCOVER += 1;
+                  p = eptr+1;
+                }
+              while (*eptr == ',');
+            }
             break;
           case 'n':
             MASK_NAME = argv[i]+2;
             break;
+          case 'T':
+            ARG_POSITIVE(NTHREADS,"Number of threads")
+            break;
+          case 'p':
+            ARG_POSITIVE(PILE_CAP,"Maximum pile size")
+            break;
         }
       else
         argv[j++] = argv[i];
     argc = j;
 
     VERBOSE = flags['v'];
+    MERGE   = flags['m'];
 
     if (argc < 3)
       { fprintf(stderr,"Usage: %s %s\n",Prog_Name,Usage);
         fprintf(stderr,"\n");
         fprintf(stderr,"      -v: Verbose mode, output statistics as proceed.\n");
+        fprintf(stderr,"      -m: merge the unmerged block-pair .las files of each argument,\n");
+        fprintf(stderr,"          e.g. DB.3.DB.@1-8, on the fly.\n");
         fprintf(stderr,"      -c: cutoff depth for declaring an interval repetitive.\n");
+        fprintf(stderr,"          Given a list, a track <-n><cutoff> is made for each cutoff.\n");
         fprintf(stderr,"      -n: use this name as for the repeat mask track\n");
+        fprintf(stderr,"      -T: use -T threads.\n");
+        fprintf(stderr,"      -p: stream piles of more than -p LAs in bounded memory.\n");
         exit (1);
       }
-    if (MIN_COVER <= 0)
+    if (NCOVER <= 0)
       { fprintf(stderr,"%s: Must supply -c parameter for repeat threshold\n",Prog_Name);
         exit (1);
       }
   }
 
-  //  Open trimmed DB
+  //  Name a track for each threshold and set up its output vectors
 
-  { status = Open_DB(argv[1],DB);
-    if (status < 0)
-      exit (1);
-    if (DB->part)
-      { fprintf(stderr,"%s: Cannot be called on a block: %s\n",Prog_Name,argv[1]);
+  TRACK     = (char **) Malloc(sizeof(char *)*NCOVER,"Allocating track names");
+  MSK_TRACK = (Track_Writer **) Malloc(sizeof(Track_Writer *)*NCOVER,"Allocating track files");
+  if (TRACK == NULL || MSK_TRACK == NULL)
+    exit (1);
+  for (t = 0; t < NCOVER; t++)
+    { if (NCOVER == 1)
+        TRACK[t] = Strdup(MASK_NAME,"Allocating track names");
+      else
+        TRACK[t] = Strdup(Numbered_Suffix(MASK_NAME,MIN_COVER[t],""),"Allocating track names");
+      if (TRACK[t] == NULL)
         exit (1);
+    }
+
+  //  Find the DB stub.  Only the index of the block of each .las file is loaded when it is
+  //    processed.
+
+  { FILE *dbfile;
+    char *p, *eptr;
+    int   plen;
+
+    dpwd = PathTo(argv[1]);
+    plen = strlen(argv[1]);
+    if (plen > 4 && strcmp(argv[1]+(plen-4),".dam") == 0)
+      root = Root(argv[1],".dam");
+    else
+      root = Root(argv[1],".db");
+
+    p = rindex(root,'.');
+    if (p != NULL && p[1] != '\0' && p[1] != '-')
+      { if (strtol(p+1,&eptr,10) > 0 && *eptr == '\0')
+          { fprintf(stderr,"%s: Cannot be called on a block: %s\n",Prog_Name,argv[1]);
+            exit (1);
+          }
       }
-    Trim_DB(DB);
-    Reads = DB->reads;
+
+    status = 0;
+    dbfile = fopen(Catenate(dpwd,"/",root,".db"),"r");
+    if (dbfile == NULL)
+      { status = 1;
+        dbfile = fopen(Catenate(dpwd,"/",root,".dam"),"r");
+        if (dbfile == NULL)
+          { fprintf(stderr,"%s: Could not open %s as a DB or a DAM\n",Prog_Name,argv[1]);
+            exit (1);
+          }
+      }
+    fclose(dbfile);
   }
 
+  //  Allocate thread work areas
+
+  parm = (Partition_Arg *) Malloc(sizeof(Partition_Arg)*(NTHREADS+1),
+                                  "Allocating thread records");
+  if (parm == NULL)
+    exit (1);
+  memset(parm,0,sizeof(Partition_Arg)*(NTHREADS+1));
+  for (c = 0; c <= NTHREADS; c++)
+    { parm[c].out = (Partition_Out *) Malloc(sizeof(Partition_Out)*NCOVER,
+                                              "Allocating thread records");
+      if (parm[c].out == NULL)
+        exit (1);
+      memset(parm[c].out,0,sizeof(Partition_Out)*NCOVER);
+    }
+
+  pass.nthreads = NTHREADS;
+  pass.arg      = (void **) Malloc(sizeof(void *)*(NTHREADS+1),"Allocating thread records");
+  if (pass.arg == NULL)
+    exit (1);
+  for (c = 0; c <= NTHREADS; c++)
+    pass.arg[c] = parm+c;
+  pass.nmin   = BATCH_OVLS;
+  pass.cap    = PILE_CAP;
+  pass.start  = START;
+  pass.pile   = PARTITION;
+  pass.giant  = GIANT;
+  pass.finish = FINISH;
+
   //  Initialize statistics gathering
 
   if (VERBOSE)
@@ -600,135 +1056,205 @@ int main(int argc, char *argv[])
 
       nreads = 0;
       totlen = 0;
-      masked = 0;
-      nmasks = 0;
+      ngiant = 0;
 
-      printf("\nREPmask -c%d -n%s %s",MIN_COVER,MASK_NAME,argv[1]);
+      printf("\nREPmask -c%d",MIN_COVER[0]);
+      for (i = 1; i < NCOVER; i++)
+        printf(",%d",MIN_COVER[i]);
+      printf(" -n%s %s",MASK_NAME,argv[1]);
       for (i = 2; i < argc; i++)
         printf(" %s",argv[i]);
       printf("\n");
     }
 
-  //  Determine if overlap block is being processed and if so get first and last read
-  //    from .db file
-
-  dpwd = PathTo(argv[1]);
-  if (status)
-    root = Root(argv[1],".dam");
-  else
-    root = Root(argv[1],".db");
+  //  For each .las file (or set of block-pair files if merging) open the (trimmed) DB block
+  //    it is for, or the entire DB
 
   for (c = 2; c < argc; c++)
     { Block_Looper *parse;
-      FILE         *input;
+      FILE         *input, **inputs;
+      Las_Index   **index;
+      Las_Piles    *piles;
+      int           nin, imax;
 
       parse = Parse_Block_LAS_Arg(argv[c]);
 
+      imax   = 10;
+      inputs = (FILE **) Malloc(sizeof(FILE *)*imax,"Allocating file list");
+      index  = (Las_Index **) Malloc(sizeof(Las_Index *)*imax,"Allocating file list");
+      if (inputs == NULL || index == NULL)
+        exit (1);
+
       while ((input = Next_Block_Arg(parse)) != NULL)
-        { DB_PART  = 0;
-          DB_FIRST = 0;
-          DB_LAST  = DB->nreads;
-
-          { FILE *dbfile;
-            char  buffer[2*MAX_NAME+100];
-            char *p, *eptr;
-            int   i, part, nfiles, nblocks, cutoff, all, oindx;
-            int64 size;
-
-            p = rindex(Block_Arg_Root(parse),'.');
-            if (p != NULL)
-              { part = strtol(p+1,&eptr,10);
-                if (*eptr == '\0' && eptr != p+1)
-                  { if (status)
-                      dbfile = Fopen(Catenate(dpwd,"/",root,".dam"),"r");
-                    else
-                      dbfile = Fopen(Catenate(dpwd,"/",root,".db"),"r");
-                    if (dbfile == NULL)
-			    exit (1);
-                    if (fscanf(dbfile,DB_NFILE,&nfiles) != 1)
-                      SYSTEM_READ_ERROR
-                    for (i = 0; i < nfiles; i++)
-                      if (fgets(buffer,2*MAX_NAME+100,dbfile) == NULL)
-                        SYSTEM_READ_ERROR
-                    if (fscanf(dbfile,DB_NBLOCK,&nblocks) != 1)
-                      SYSTEM_READ_ERROR
-                    if (fscanf(dbfile,DB_PARAMS,&size,&cutoff,&all) != 3)
-                      SYSTEM_READ_ERROR
-                    for (i = 1; i <= part; i++)
-                      if (fscanf(dbfile,DB_BDATA,&oindx,&DB_FIRST) != 2)
-                        SYSTEM_READ_ERROR
-                    if (fscanf(dbfile,DB_BDATA,&oindx,&DB_LAST) != 2)
-                      SYSTEM_READ_ERROR
-                    fclose(dbfile);
-                    DB_PART = part;
+        { char *name, *p, *eptr;
+          int   part, error;
+
+          name = Block_Arg_Root(parse);
+
+          nin = 0;
+          index[nin]    = Block_Las_Index(parse,input);
+          inputs[nin++] = input;
+          if (MERGE)
+            while ((input = Next_Block_Arg(parse)) != NULL)
+              { if (nin >= imax)
+                  { imax   = 1.2*nin + 10;
+                    inputs = (FILE **) Realloc(inputs,sizeof(FILE *)*imax,"Expanding file list");
+                    index  = (Las_Index **) Realloc(index,sizeof(Las_Index *)*imax,
+                                                    "Expanding file list");
+                    if (inputs == NULL || index == NULL)
+                      exit (1);
                   }
+                index[nin]    = Block_Las_Index(parse,input);
+                inputs[nin++] = input;
               }
-          }
 
-          //   Set up preliminary trimming track
-
-          { int   len, size;
-            char  ans[strlen(MASK_NAME)+7];
-            char  dts[strlen(MASK_NAME)+7];
+          //  The block is the last number in the name of a .las file, and the first number
+          //    after the DB root, e.g. DB.3 in DB.3.DB.5, in the name of a block-pair file
 
-            strcpy(ans,Catenate(".",MASK_NAME,".","anno"));
-            strcpy(dts,Catenate(".",MASK_NAME,".","data"));
-            if (DB_PART > 0)
-              { MSK_AFILE = Fopen(Catenate(dpwd,PATHSEP,root,
-                                       Numbered_Suffix(".",DB_PART,ans)),"w");
-                MSK_DFILE = Fopen(Catenate(dpwd,PATHSEP,root,
-                                       Numbered_Suffix(".",DB_PART,dts)),"w");
-              }
-            else
-              { MSK_AFILE = Fopen(Catenate(dpwd,PATHSEP,root,ans),"w");
-                MSK_DFILE = Fopen(Catenate(dpwd,PATHSEP,root,dts),"w");
-              }
-            if (MSK_AFILE == NULL || MSK_DFILE == NULL)
-              exit (1);
-
-            len  = DB_LAST - DB_FIRST;
-            size = 0;
-            fwrite(&len,sizeof(int),1,MSK_AFILE);
-            fwrite(&size,sizeof(int),1,MSK_AFILE);
-            MSK_INDEX = 0;
-            fwrite(&MSK_INDEX,sizeof(int64),1,MSK_AFILE);
-          }
+          DB_PART = 0;
+          if (MERGE)
+            { int len = strlen(root);
 
-          //  Get trace point spacing information
+              if (strncmp(name,root,len) == 0 && name[len] == '.')
+                { part = strtol(name+len+1,&eptr,10);
+                  if (*eptr == '.' && eptr != name+len+1)
+                    DB_PART = part;
+                }
+            }
+          else
+            { p = rindex(name,'.');
+              if (p != NULL)
+                { part = strtol(p+1,&eptr,10);
+                  if (*eptr == '\0' && eptr != p+1)
+                    DB_PART = part;
+                }
+            }
 
-          fread(&novl,sizeof(int64),1,input);
-          fread(&TRACE_SPACING,sizeof(int),1,input);
+          if (DB_PART > 0)
+            p = Catenate(dpwd,"/",root,Numbered_Suffix(".",DB_PART,status ? ".dam" : ".db"));
+          else
+            p = Catenate(dpwd,"/",root,status ? ".dam" : ".db");
+          if (Open_DB(p,DB) < 0)
+            exit (1);
+          if (Well_Start == NULL)
+            build_wells(DB);
+          Trim_DB(DB);
 
-          //  Process each read pile
+          DB_FIRST = DB->tfirst;
+          DB_LAST  = DB_FIRST + DB->nreads;
 
-          make_a_pass(input,PARTITION,1);
+          //   Set up preliminary trimming track
 
-          fclose(MSK_AFILE);
-          fclose(MSK_DFILE);
-          fclose(input);
+          for (t = 0; t < NCOVER; t++)
+            if (DB_PART > 0)
+              MSK_TRACK[t] = Open_Track_Writer(Catenate(dpwd,PATHSEP,root,
+                                                        Numbered_Suffix(".",DB_PART,"")),TRACK[t]);
+            else
+              MSK_TRACK[t] = Open_Track_Writer(Catenate(dpwd,PATHSEP,root,""),TRACK[t]);
+
+          //  Partition each successive batch of piles with NTHREADS threads and write out the
+          //    result of each in order.  A batch ends early at a pile of more than PILE_CAP
+          //    LAs, which the main thread streams with parm[NTHREADS] while the threads work.
+
+          piles = Open_Merged_Piles(nin,inputs,name);
+          if (piles == NULL)
+            exit (1);
+          for (t = 0; t < nin; t++)
+            Index_Piles(piles,t,index[t]);
+          error = Pass_Piles(piles,DB_FIRST,DB_LAST,&pass);
+          if (error > 0)
+            { fprintf(stderr,"%s: .las file overlaps don't correspond to reads",Prog_Name);
+              fprintf(stderr," in block %d of DB\n",DB_PART);
+            }
+          if (error != 0)
+            exit (1);
+          Close_Piles(piles);
+          for (t = 0; t < nin; t++)
+            Free_Las_Index(index[t]);
+
+          for (t = 0; t < NCOVER; t++)
+            Close_Track_Writer(MSK_TRACK[t]);
+          while (nin-- > 0)
+            fclose(inputs[nin]);
+          free(name);
+          Close_DB(DB);
         }
 
+      free(index);
+      free(inputs);
       Free_Block_Arg(parse);
     }
 
   if (VERBOSE)
-    { printf("\nInput:    ");
+    { int i;
+
+      for (i = 0; i <= NTHREADS; i++)
+        { nreads += parm[i].nreads;
+          totlen += parm[i].totlen;
+        }
+
+      printf("\nInput:    ");
       Print_Number((int64) nreads,7,stdout);
       printf(" (100.0%%) reads     ");
       Print_Number(totlen,12,stdout);
       printf(" (100.0%%) bases\n");
 
-      printf("Masks:    ");
-      Print_Number(nmasks,7,stdout);
-      printf(" (%5.1f%%) masks     ",(100.*nmasks)/nreads);
-      Print_Number(masked,12,stdout);
-      printf(" (%5.1f%%) bases\n",(100.*masked)/totlen);
+      for (t = 0; t < NCOVER; t++)
+        { int64 nmasks, masked;
+
+          nmasks = masked = 0;
+          for (i = 0; i <= NTHREADS; i++)
+            { nmasks += parm[i].out[t].nmasks;
+              masked += parm[i].out[t].masked;
+            }
+
+          if (NCOVER == 1)
+            printf("Masks:    ");
+          else
+            printf("c = %-5d ",MIN_COVER[t]);
+          Print_Number(nmasks,7,stdout);
+          printf(" (%5.1f%%) masks     ",(100.*nmasks)/nreads);
+          Print_Number(masked,12,stdout);
+          printf(" (%5.1f%%) bases\n",(100.*masked)/totlen);
+        }
+
+      if (ngiant > 0)
+        { printf("Streamed: ");
+          Print_Number(ngiant,7,stdout);
+          printf(" piles of more than %d LAs\n",PILE_CAP);
+        }
     }
 
+  { int i;
+
+    for (i = 0; i <= NTHREADS; i++)
+      { for (t = 0; t < NCOVER; t++)
+          { free(parm[i].out[t].data);
+            free(parm[i].out[t].ints);
+          }
+        free(parm[i].out);
+        free(parm[i].trim);
+        free(parm[i].steps);
+        free(parm[i].ev);
+        free(parm[i].tally);
+        free(parm[i].ovls);
+      }
+    free(pass.arg);
+    free(parm);
+  }
+
   free(dpwd);
   free(root);
 
-  Close_DB(DB);
+  for (t = 0; t < NCOVER; t++)
+    free(TRACK[t]);
+  free(TRACK);
+  free(MSK_TRACK);
+  free(MIN_COVER);
+  if (Well_Map != NULL)
+    munmap(Well_Map,Well_Size);
+  else
+    free(Well_Start);
   free(Prog_Name);
 
   exit (0);
@@ -16,6 +16,8 @@
 
 #include "DB.h"
 #include "align.h"
+#include "pile.h"
+#include "track.h"
 
 #ifdef HIDE_FILES
 #define PATHSEP "/."
@@ -23,7 +25,8 @@
 #define PATHSEP "/"
 #endif
 
-static char *Usage = "[-v] [-n<track(tan)>] [-l<int(500)>] <source:db> <overlaps:las> ...";
+static char *Usage = "[-v] [-n<track(tan)>] [-l<int(500)>] [-T<int(4)>] [-p<int(250000)>]\n"
+                     "               <source:db> <overlaps:las> ...";
 
 
 //  Partition Constants
@@ -35,6 +38,8 @@ static char *Usage = "[-v] [-n<track(tan)>] [-l<int(500)>] <source:db> <overlaps
 
 static int VERBOSE;
 static int MIN_LEN;
+static int NTHREADS;
+static int PILE_CAP;              //  Piles with more LAs than this are streamed (see GIANT)
 
 static DAZZ_DB _DB, *DB = &_DB;   //  Data base
 
@@ -42,18 +47,34 @@ static int DB_PART;               //  Input is an Overlap block
 static int DB_FIRST;              //     for reads DB_FIRST to DB_LAST-1
 static int DB_LAST;
 
-static int TRACE_SPACING;         //  Trace spacing (from .las file)
-static int TBYTES;                //  Bytes per trace segment (from .las file)
-
-static FILE   *TN_AFILE;          //  .tan.anno
-static FILE   *TN_DFILE;          //  .tan.data
-static int64   TN_INDEX;          //  Current index into .tan.data file as it is being written
+static Track_Writer *TN_TRACK;    //  .tan.anno & .tan.data
 
 //  Statistics
 
 static int64 nreads, totlen;
 static int64 nmasks, masked;
-
+static int64 ngiant;
+
+
+  //  Each thread masks a contiguous range of the piles of a batch, [rbeg,rend), using its
+  //    own sort vectors, and appends the intervals found to its own data vector.  The # of
+  //    interval ends found for read j is ints[j-rbeg].
+
+typedef struct
+  { int      rbeg, rend;   //  Reads of the batch to process
+    int      nmax;         //  Sort vectors for TANDEM
+    int     *add;
+    int     *del;
+    int      dmax;         //  Interval ends found, data[0..dtop)
+    int      dtop;
+    int     *data;
+    int      imax;
+    int     *ints;
+    int      cmax;         //  Event tallies of a giant pile, 2*cmax ints
+    int     *tally;
+    int64    nreads, totlen;
+    int64    nmasks, masked;
+  } Tandem_Arg;
 
 static int ISORT(const void *l, const void *r)
 { int x = *((int *) l);
@@ -61,22 +82,19 @@ static int ISORT(const void *l, const void *r)
   return (x-y);
 }
 
-static void TANDEM(int aread, Overlap *ovls, int novl)
-{ static int  nmax = -1;
-  static int *add = NULL;
-  static int *del;
-
-  int evnum;
-
-  (void) aread;
+static void TANDEM(void *arg, int aread, Overlap *ovls, int novl)
+{ Tandem_Arg *parm = (Tandem_Arg *) arg;
+  int *add, *del;
+  int *data;
+  int  evnum, dtop;
 
   if (VERBOSE)
-    { nreads += 1;
-      totlen += DB->reads[aread].rlen;
+    { parm->nreads += 1;
+      parm->totlen += DB->reads[aread-DB_FIRST].rlen;
     }
 
   if (novl == 0)
-    { fwrite(&TN_INDEX,sizeof(int64),1,TN_AFILE);
+    { parm->ints[aread-parm->rbeg] = 0;
       return;
     }
 
@@ -84,13 +102,24 @@ static void TANDEM(int aread, Overlap *ovls, int novl)
   printf("\nAREAD %d:\n",aread);
 #endif
 
-  if (novl > nmax)
-    { nmax = 1.2*novl + 500;
-      add  = (int *) Realloc(add,4*sizeof(int)*nmax,"Allocating sort vector");
-      if (add == NULL)
+  if (novl > parm->nmax)
+    { parm->nmax = 1.2*novl + 500;
+      parm->add  = (int *) Realloc(parm->add,2*sizeof(int)*parm->nmax,"Allocating sort vector");
+      if (parm->add == NULL)
+        exit (1);
+      parm->del = parm->add + parm->nmax;
+    }
+  add = parm->add;
+  del = parm->del;
+
+  if (parm->dtop + 2*novl > parm->dmax)
+    { parm->dmax = 1.2*(parm->dtop+2*novl) + 10000;
+      parm->data = (int *) Realloc(parm->data,sizeof(int)*parm->dmax,"Allocating interval vector");
+      if (parm->data == NULL)
         exit (1);
-      del = add + nmax;
     }
+  data = parm->data;
+  dtop = parm->dtop;
 
   //  For each overlapping LA record mask interval as an add and del event
   //    that are then sorted
@@ -113,7 +142,7 @@ static void TANDEM(int aread, Overlap *ovls, int novl)
     qsort(del,evnum,sizeof(int),ISORT);
   }
 
-  //  Output the union of the mask intervals to the .tan track
+  //  Record the union of the mask intervals
 
   { int i, j, x, a;
 
@@ -122,8 +151,7 @@ static void TANDEM(int aread, Overlap *ovls, int novl)
     while (j < evnum)
       if (i < evnum && add[i] <= del[j])
         { if (x == 0)
-            { fwrite(add+i,sizeof(int),1,TN_DFILE);
-              TN_INDEX += sizeof(int);
+            { data[dtop++] = add[i];
 #ifdef DEBUG
               printf("  + %5d: %3d\n",add[i],x);
 #endif
@@ -135,142 +163,173 @@ static void TANDEM(int aread, Overlap *ovls, int novl)
       else
         { x -= 1;
           if (x == 0)
-            { fwrite(del+j,sizeof(int),1,TN_DFILE);
-              TN_INDEX += sizeof(int);
+            { data[dtop++] = del[j];
 #ifdef DEBUG
               printf("  - %5d: %3d\n",del[j],x);
 #endif
               if (VERBOSE)
-                { masked += del[j]-a;
-                  nmasks += 1;
+                { parm->masked += del[j]-a;
+                  parm->nmasks += 1;
                 }
             }
           j += 1;
         }
-#ifdef DEBUG
-    printf("   %lld\n",TN_INDEX);
-#endif
-    fwrite(&TN_INDEX,sizeof(int64),1,TN_AFILE);
   }
 
+  parm->ints[aread-parm->rbeg] = dtop - parm->dtop;
+  parm->dtop = dtop;
 }
 
-  //  Read in each successive pile and call ACTION on it.  Read in the traces only if
-  //   "trace" is nonzero
+  //  Mask the pile of aread, which has too many LAs to hold, as it is streamed from piles
+  //    PART_OVLS LAs at a time, tallying the starts and ends of the mask intervals in a vector
+  //    over the positions of aread.  At a position starts are taken before ends as above.
 
-static int make_a_pass(FILE *input, void (*ACTION)(int, Overlap *, int), int trace)
-{ static Overlap *ovls = NULL;
-  static int      omax = 500;
-  static uint16  *paths = NULL;
-  static int      pmax = 100000;
+#define PART_OVLS  100000
 
-  int64 i, j, novl;
-  int   n, a;
-  int   pcur;
-  int   max;
+static void GIANT(void *arg, int aread, Las_Piles *piles)
+{ Tandem_Arg *parm = (Tandem_Arg *) arg;
+  int  rlen = DB->reads[aread-DB_FIRST].rlen;
+  int *nadd, *ndel;
+  int *data;
+  int  dtop;
 
-  if (ovls == NULL)
-    { ovls = (Overlap *) Malloc(sizeof(Overlap)*omax,"Allocating overlap buffer");
-      if (ovls == NULL)
-        exit (1);
+  ngiant += 1;
+  if (VERBOSE)
+    { parm->nreads += 1;
+      parm->totlen += rlen;
     }
-  if (trace && paths == NULL)
-    { paths = (uint16 *) Malloc(sizeof(uint16)*pmax,"Allocating path buffer");
-      if (paths == NULL)
+
+#ifdef DEBUG
+  printf("\nAREAD %d:\n",aread);
+#endif
+
+  if (rlen >= parm->cmax)
+    { parm->cmax  = 1.2*rlen + 1000;
+      parm->tally = (int *) Realloc(parm->tally,sizeof(int)*2*parm->cmax,
+                                    "Allocating tally vector");
+      if (parm->tally == NULL)
         exit (1);
     }
+  nadd = parm->tally;
+  ndel = parm->tally + parm->cmax;
+  memset(nadd,0,sizeof(int)*(rlen+1));
+  memset(ndel,0,sizeof(int)*(rlen+1));
 
-  rewind(input);
-  fread(&novl,sizeof(int64),1,input);
-  fread(&TRACE_SPACING,sizeof(int),1,input);
-  if (TRACE_SPACING <= TRACE_XOVR)
-    TBYTES = sizeof(uint8);
-  else
-    TBYTES = sizeof(uint16);
-
-  if (Read_Overlap(input,ovls) != 0)
-    ovls[0].aread = INT32_MAX;
-  else if (trace)
-    { if (ovls[0].path.tlen > pmax)
-        { pmax  = 1.2*(ovls[0].path.tlen)+10000;
-          paths = (uint16 *) Realloc(paths,sizeof(uint16)*pmax,"Expanding path buffer");
-          if (paths == NULL) exit (1);
-        }
-      fread(paths,TBYTES,ovls[0].path.tlen,input);
-      if (TBYTES == 1)
-        { ovls[0].path.trace = paths;
-          Decompress_TraceTo16(ovls);
-        }
-    }
-  else
-    fseek(input,TBYTES*ovls[0].path.tlen,SEEK_CUR);
+  { int   i, m;
+    Path *ipath;
 
-  if (ovls[0].aread < DB_FIRST)
-    { fprintf(stderr,"%s: .las file overlaps don't correspond to reads in block %d of DB\n",
-                     Prog_Name,DB_PART);
+    while ((m = Next_Pile_Part(piles,aread,PART_OVLS)) > 0)
+      for (i = 0; i < m; i++)
+        { ipath = &(piles->ovls[i].path);
+          if (ipath->abpos - ipath->bepos <= SEP_FUZZ)
+            { if (ipath->aepos - ipath->bbpos > MIN_LEN)
+                { nadd[ipath->bbpos] += 1;
+                  ndel[ipath->aepos] += 1;
+                }
+            }
+        }
+    if (m < 0)
       exit (1);
+  }
+
+  if (2*(rlen+1) > parm->dmax)
+    { parm->dmax = 2.4*(rlen+1) + 10000;
+      parm->data = (int *) Realloc(parm->data,sizeof(int)*parm->dmax,"Allocating interval vector");
+      if (parm->data == NULL)
+        exit (1);
     }
+  data = parm->data;
+  dtop = 0;
 
-  pcur = 0;
-  n = max = 0;
-  for (j = DB_FIRST; j < DB_LAST; j++)
-    { ovls[0] = ovls[n];
-      a = ovls[0].aread;
-      if (a != j)
-        n = 0;
-      else
-        { if (trace)
-            memmove(paths,paths+pcur,sizeof(uint16)*ovls[0].path.tlen);
-          n = 1;
-          pcur = ovls[0].path.tlen;
-          while (1)
-            { if (Read_Overlap(input,ovls+n) != 0)
-                { ovls[n].aread = INT32_MAX;
-                  break;
-                }
-              if (trace)
-                { if (pcur + ovls[n].path.tlen > pmax)
-                    { pmax = 1.2*(pcur+ovls[n].path.tlen)+10000;
-                      paths = (uint16 *) Realloc(paths,sizeof(uint16)*pmax,"Expanding path buffer");
-                      if (paths == NULL) exit (1);
-                    }
-                  fread(paths+pcur,TBYTES,ovls[n].path.tlen,input);
-                  if (TBYTES == 1)
-                    { ovls[n].path.trace = paths+pcur;
-                      Decompress_TraceTo16(ovls+n);
-                    }
-                }
-              else
-                fseek(input,TBYTES*ovls[n].path.tlen,SEEK_CUR);
-              if (ovls[n].aread != a)
-                break;
-              pcur += ovls[n].path.tlen;
-              n    += 1;
-              if (n >= omax)
-                { omax = 1.2*n + 100;
-                  ovls = (Overlap *) Realloc(ovls,sizeof(Overlap)*omax,"Expanding overlap buffer");
-                  if (ovls == NULL) exit (1);
-                }
-            }
+  //  Record the union of the mask intervals
 
-          if (n >= max)
-            max = n;
-          pcur = 0;
-          for (i = 0; i < n; i++)
-            { ovls[i].path.trace = paths+pcur;
-              pcur += ovls[i].path.tlen;
-            }
-        }
-      ACTION(j,ovls,n);
+  { int i, x, a;
+
+    x = a = 0;
+    for (i = 0; i <= rlen; i++)
+      { if (nadd[i] > 0)
+          { if (x == 0)
+              { data[dtop++] = i;
+#ifdef DEBUG
+                printf("  + %5d: %3d\n",i,x);
+#endif
+                a = i;
+              }
+            x += nadd[i];
+          }
+        if (ndel[i] > 0)
+          { x -= ndel[i];
+            if (x == 0)
+              { data[dtop++] = i;
+#ifdef DEBUG
+                printf("  - %5d: %3d\n",i,x);
+#endif
+                if (VERBOSE)
+                  { parm->masked += i-a;
+                    parm->nmasks += 1;
+                  }
+              }
+          }
+      }
+  }
+
+  parm->ints[0] = dtop;
+  parm->dtop    = dtop;
+}
+
+  //  Set up parm to mask the piles of reads [rbeg,rend)
+
+static void START(void *arg, int rbeg, int rend)
+{ Tandem_Arg *parm = (Tandem_Arg *) arg;
+
+  parm->rbeg = rbeg;
+  parm->rend = rend;
+  if (rend - rbeg > parm->imax)
+    { parm->imax = 1.2*(rend-rbeg) + 1000;
+      parm->ints = (int *) Realloc(parm->ints,sizeof(int)*parm->imax,"Expanding pile index");
+      if (parm->ints == NULL)
+        exit (1);
     }
+  parm->dtop = 0;
+}
 
-  if (ovls[n].aread < INT32_MAX)
-    { fprintf(stderr,"%s: .las file overlaps don't correspond to reads in block %d of DB\n",
-                     Prog_Name,DB_PART);
-      exit (1);
+  //  Write the intervals found by parm to the track files in read order
+
+static void FINISH(void *arg)
+{ Tandem_Arg *parm = (Tandem_Arg *) arg;
+  int j, d, n;
+
+  d = 0;
+  for (j = parm->rbeg; j < parm->rend; j++)
+    { n = parm->ints[j-parm->rbeg];
+      Add_Track_Read(TN_TRACK,parm->data+d,n);
+      d += n;
     }
+}
 
-  return (max);
+  //  The piles of the .las file are gathered in batches of at least BATCH_OVLS LAs
+
+#define BATCH_OVLS  250000
+
+  //  Mask each successive batch of piles with NTHREADS threads, and write out the result of
+  //    each in order.  A batch ends early at a pile of more than PILE_CAP LAs, which the main
+  //    thread then streams with parm[NTHREADS] while the threads work on the batch.
+
+static void make_a_pass(FILE *input, char *name, Las_Index *index, Pile_Pass *pass)
+{ Las_Piles *piles;
+  int        error;
+
+  piles = Open_Piles(input,name);
+  if (piles == NULL)
+    exit (1);
+  Index_Piles(piles,0,index);
+  error = Pass_Piles(piles,DB_FIRST,DB_LAST,pass);
+  if (error > 0)
+    fprintf(stderr,"%s: .las file overlaps don't correspond to reads in block %d of DB\n",
+                   Prog_Name,DB_PART);
+  if (error != 0)
+    exit (1);
+  Close_Piles(piles);
 }
 
 int main(int argc, char *argv[])
@@ -278,6 +337,8 @@ int main(int argc, char *argv[])
   int         status;
   int         c;
   char       *MASK_NAME;
+  Tandem_Arg *parm;
+  Pile_Pass   pass;
 
   //  Process arguments
 
@@ -289,6 +350,8 @@ int main(int argc, char *argv[])
 
     MIN_LEN   = 500;
     MASK_NAME = "tan";
+    NTHREADS  = 4;
+    PILE_CAP  = 250000;
 
     j = 1;
     for (i = 1; i < argc; i++)
@@ -303,6 +366,12 @@ int main(int argc, char *argv[])
           case 'l':
             ARG_POSITIVE(MIN_LEN,"Minimum retained segment length")
             break;
+          case 'T':
+            ARG_POSITIVE(NTHREADS,"Number of threads")
+            break;
+          case 'p':
+            ARG_POSITIVE(PILE_CAP,"Maximum pile size")
+            break;
         }
       else
         argv[j++] = argv[i];
@@ -316,20 +385,68 @@ int main(int argc, char *argv[])
         fprintf(stderr,"      -v: Verbose mode, output statistics as proceed.\n");
         fprintf(stderr,"      -l: shortest tandem interval to report.\n");
         fprintf(stderr,"      -n: use this name as for the tandem mask track\n");
+        fprintf(stderr,"      -T: use -T threads.\n");
+        fprintf(stderr,"      -p: stream piles of more than -p LAs in bounded memory.\n");
         exit (1);
       }
   }
 
-  //  Open trimmed DB
+  //  Find the DB stub.  Only the index of the block of each .las file is loaded when it is
+  //    processed.
+
+  { FILE *dbfile;
+    char *p, *eptr;
+    int   plen;
+
+    dpwd = PathTo(argv[1]);
+    plen = strlen(argv[1]);
+    if (plen > 4 && strcmp(argv[1]+(plen-4),".dam") == 0)
+      root = Root(argv[1],".dam");
+    else
+      root = Root(argv[1],".db");
+
+    p = rindex(root,'.');
+    if (p != NULL && p[1] != '\0' && p[1] != '-')
+      { if (strtol(p+1,&eptr,10) > 0 && *eptr == '\0')
+          { fprintf(stderr,"%s: Cannot be called on a block: %s\n",Prog_Name,argv[1]);
+            exit (1);
+          }
+      }
 
-  { status = Open_DB(argv[1],DB);
-    if (status < 0)
-      exit (1);
-    if (DB->part)
-      { fprintf(stderr,"%s: Cannot be called on a block: %s\n",Prog_Name,argv[1]);
-        exit (1);
+    status = 0;
+    dbfile = fopen(Catenate(dpwd,"/",root,".db"),"r");
+    if (dbfile == NULL)
+      { status = 1;
+        dbfile = fopen(Catenate(dpwd,"/",root,".dam"),"r");
+        if (dbfile == NULL)
+          { fprintf(stderr,"%s: Could not open %s as a DB or a DAM\n",Prog_Name,argv[1]);
+            exit (1);
+          }
       }
-    Trim_DB(DB);
+    fclose(dbfile);
+  }
+
+  //  Allocate thread work areas
+
+  parm = (Tandem_Arg *) Malloc(sizeof(Tandem_Arg)*(NTHREADS+1),"Allocating thread records");
+  if (parm == NULL)
+    exit (1);
+  memset(parm,0,sizeof(Tandem_Arg)*(NTHREADS+1));
+
+  { int i;
+
+    pass.nthreads = NTHREADS;
+    pass.arg      = (void **) Malloc(sizeof(void *)*(NTHREADS+1),"Allocating thread records");
+    if (pass.arg == NULL)
+      exit (1);
+    for (i = 0; i <= NTHREADS; i++)
+      pass.arg[i] = parm+i;
+    pass.nmin   = BATCH_OVLS;
+    pass.cap    = PILE_CAP;
+    pass.start  = START;
+    pass.pile   = TANDEM;
+    pass.giant  = GIANT;
+    pass.finish = FINISH;
   }
 
   //  Initialize statistics gathering
@@ -341,6 +458,7 @@ int main(int argc, char *argv[])
       totlen = 0;
       masked = 0;
       nmasks = 0;
+      ngiant = 0;
 
       printf("\nTANmask -l%d -n%s %s",MIN_LEN,MASK_NAME,argv[1]);
       for (i = 2; i < argc; i++)
@@ -348,105 +466,74 @@ int main(int argc, char *argv[])
       printf("\n");
     }
 
-  //  Determine if overlap block is being processed and if so get first and last read
-  //    from .db file
-
-  dpwd = PathTo(argv[1]);
-  if (status)
-    root = Root(argv[1],".dam");
-  else
-    root = Root(argv[1],".db");
+  //  For each .las file open the (trimmed) DB block it is for, or the entire DB
 
   for (c = 2; c < argc; c++)
     { Block_Looper *parse;
       FILE         *input;
+      Las_Index    *index;
 
       parse = Parse_Block_LAS_Arg(argv[c]);
 
       while ((input = Next_Block_Arg(parse)) != NULL)
-        { DB_PART  = 0;
-          DB_FIRST = 0;
-          DB_LAST  = DB->nreads;
-
-          { FILE *dbfile;
-            char  buffer[2*MAX_NAME+100];
-            char *p, *eptr;
-            int   i, part, nfiles, nblocks, cutoff, all, oindx;
-            int64 size;
-
-            p = rindex(Block_Arg_Root(parse),'.');
-            if (p != NULL)
-              { part = strtol(p+1,&eptr,10);
-                if (*eptr == '\0' && eptr != p+1)
-                  { if (status)
-                      dbfile = Fopen(Catenate(dpwd,"/",root,".dam"),"r");
-                    else
-                      dbfile = Fopen(Catenate(dpwd,"/",root,".db"),"r");
-                    if (dbfile == NULL)
-                      exit (1);
-                    if (fscanf(dbfile,DB_NFILE,&nfiles) != 1)
-                      SYSTEM_READ_ERROR
-                    for (i = 0; i < nfiles; i++)
-                      if (fgets(buffer,2*MAX_NAME+100,dbfile) == NULL)
-                        SYSTEM_READ_ERROR
-                    if (fscanf(dbfile,DB_NBLOCK,&nblocks) != 1)
-                      SYSTEM_READ_ERROR
-                    if (fscanf(dbfile,DB_PARAMS,&size,&cutoff,&all) != 3)
-                      SYSTEM_READ_ERROR
-                    for (i = 1; i <= part; i++)
-                      if (fscanf(dbfile,DB_BDATA,&oindx,&DB_FIRST) != 2)
-                        SYSTEM_READ_ERROR
-                    if (fscanf(dbfile,DB_BDATA,&oindx,&DB_LAST) != 2)
-                      SYSTEM_READ_ERROR
-                    fclose(dbfile);
-                    DB_PART = part;
-                  }
-              }
-          }
+        { char *name, *p, *eptr;
+          int   part;
+
+          name = Block_Arg_Root(parse);
+
+          DB_PART = 0;
+          p = rindex(name,'.');
+          if (p != NULL)
+            { part = strtol(p+1,&eptr,10);
+              if (*eptr == '\0' && eptr != p+1)
+                DB_PART = part;
+            }
+
+          if (DB_PART > 0)
+            p = Catenate(dpwd,"/",root,Numbered_Suffix(".",DB_PART,status ? ".dam" : ".db"));
+          else
+            p = Catenate(dpwd,"/",root,status ? ".dam" : ".db");
+          if (Open_DB(p,DB) < 0)
+            exit (1);
+          Trim_DB(DB);
+
+          DB_FIRST = DB->tfirst;
+          DB_LAST  = DB_FIRST + DB->nreads;
 
           //  Set up mask track
 
-          { int len, size;
-            char  ans[strlen(MASK_NAME)+7];
-            char  dts[strlen(MASK_NAME)+7];
-
-            strcpy(ans,Catenate(".",MASK_NAME,".","anno"));
-            strcpy(dts,Catenate(".",MASK_NAME,".","data"));
-            if (DB_PART > 0)
-              { TN_AFILE = Fopen(Catenate(dpwd,PATHSEP,root,
-                                          Numbered_Suffix(".",DB_PART,ans)),"w");
-                TN_DFILE = Fopen(Catenate(dpwd,PATHSEP,root,
-                                          Numbered_Suffix(".",DB_PART,dts)),"w");
-              }
-            else
-              { TN_AFILE = Fopen(Catenate(dpwd,PATHSEP,root,ans),"w");
-                TN_DFILE = Fopen(Catenate(dpwd,PATHSEP,root,dts),"w");
-              }
-            if (TN_AFILE == NULL || TN_DFILE == NULL)
-              exit (1);
-
-            len  = DB_LAST - DB_FIRST;
-            size = 0;
-            fwrite(&len,sizeof(int),1,TN_AFILE);
-            fwrite(&size,sizeof(int),1,TN_AFILE);
-            TN_INDEX = 0;
-            fwrite(&TN_INDEX,sizeof(int64),1,TN_AFILE);
-          }
+          if (DB_PART > 0)
+            TN_TRACK = Open_Track_Writer(Catenate(dpwd,PATHSEP,root,
+                                                  Numbered_Suffix(".",DB_PART,"")),MASK_NAME);
+          else
+            TN_TRACK = Open_Track_Writer(Catenate(dpwd,PATHSEP,root,""),MASK_NAME);
 
           //  Process each read pile
 
-          make_a_pass(input,TANDEM,0);
+          index = Block_Las_Index(parse,input);
+          make_a_pass(input,name,index,&pass);
+          Free_Las_Index(index);
 
-          fclose(TN_AFILE);
-          fclose(TN_DFILE);
+          Close_Track_Writer(TN_TRACK);
           fclose(input);
+          free(name);
+          Close_DB(DB);
         }
 
       Free_Block_Arg(parse);
     }
 
   if (VERBOSE)
-    { printf("\nInput:    ");
+    { int i;
+
+      for (i = 0; i <= NTHREADS; i++)
+        { nreads += parm[i].nreads;
+          totlen += parm[i].totlen;
+          nmasks += parm[i].nmasks;
+          masked += parm[i].masked;
+        }
+
+      printf("\nInput:    ");
       Print_Number((int64) nreads,7,stdout);
       printf(" (100.0%%) reads     ");
       Print_Number(totlen,12,stdout);
@@ -457,12 +544,28 @@ int main(int argc, char *argv[])
       printf(" (%5.1f%%) masks     ",(100.*nmasks)/nreads);
       Print_Number(masked,12,stdout);
       printf(" (%5.1f%%) bases\n",(100.*masked)/totlen);
+
+      if (ngiant > 0)
+        { printf("Streamed: ");
+          Print_Number(ngiant,7,stdout);
+          printf(" piles of more than %d LAs\n",PILE_CAP);
+        }
     }
 
+  { int i;
+
+    for (i = 0; i <= NTHREADS; i++)
+      { free(parm[i].data);
+        free(parm[i].ints);
+        free(parm[i].add);
+        free(parm[i].tally);
+      }
+    free(pass.arg);
+    free(parm);
+  }
+
   free(dpwd);
   free(root);
-
-  Close_DB(DB);
   free(Prog_Name);
 
   exit (0);
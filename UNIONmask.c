@@ -0,0 +1,375 @@
+/*******************************************************************************************
+ *
+ *  UNIONmask takes as input a database or block and the names of two or more of its interval
+ *    tracks, e.g. dust, tan, and rep, and builds a single mask track that encodes the union of
+ *    their intervals, so that a downstream daligner need open and merge just one track.
+ *
+ *  Author:  agent
+ *  Date  :  October 18, 2026
+ *
+ *******************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "DB.h"
+#include "track.h"
+
+#define THREAD    pthread_t
+
+static char *Usage = "[-v] [-n<track(union)>] [-T<int(4)>] <source:db|dam> <track:name> ...";
+
+
+//  Global Data Structures
+
+static int VERBOSE;
+static int NTHREADS;
+
+static DAZZ_DB _DB, *DB = &_DB;   //  Data base or block
+
+static int          NTRACKS;      //  Input tracks, TRACKS[0..NTRACKS)
+static DAZZ_TRACK **TRACKS;
+
+static Track_Writer *UN_TRACK;    //  .union.anno & .union.data
+
+
+  //  Each thread merges the intervals of a contiguous range of reads, [rbeg,rend), and appends
+  //    the union intervals found to its own data vector.  The # of interval ends found for
+  //    read j is ints[j-rbeg].  The per track interval and base counts are in tmask & tbase.
+
+typedef struct
+  { int      rbeg, rend;   //  Reads to process
+    int      dmax;         //  Interval ends found, data[0..dtop)
+    int      dtop;
+    int     *data;
+    int      imax;
+    int     *ints;
+    int    **iv;           //  Interval lists of the current read, one per track
+    int     *ilen;
+    int     *ipos;
+    int64   *tmask, *tbase;
+    int64    nmasks, masked;
+  } Union_Arg;
+
+static void UNION(Union_Arg *parm, int aread)
+{ int  **iv   = parm->iv;
+  int   *ilen = parm->ilen;
+  int   *ipos = parm->ipos;
+  int   *data;
+  int    dtop, need;
+
+  //  Get each track's interval list for aread without copying it
+
+  { int t, len;
+
+    need = 0;
+    for (t = 0; t < NTRACKS; t++)
+      { iv[t]   = (int *) Track_Data_Span(TRACKS[t],aread,&len);
+        ilen[t] = len / sizeof(int);
+        ipos[t] = 0;
+        need   += ilen[t];
+        if (VERBOSE)
+          { int k;
+
+            parm->tmask[t] += ilen[t]/2;
+            for (k = 0; k < ilen[t]; k += 2)
+              parm->tbase[t] += iv[t][k+1] - iv[t][k];
+          }
+      }
+  }
+
+  if (parm->dtop + need > parm->dmax)
+    { parm->dmax = 1.2*(parm->dtop+need) + 10000;
+      parm->data = (int *) Realloc(parm->data,sizeof(int)*parm->dmax,"Allocating interval vector");
+      if (parm->data == NULL)
+        exit (1);
+    }
+  data = parm->data;
+  dtop = parm->dtop;
+
+  //  Merge the sorted interval lists, taking the interval with the least start next, and
+  //    record the union of the intervals
+
+  { int t, m, b, e;
+    int cb, ce;
+
+    cb = ce = -1;
+    while (1)
+      { m = -1;
+        for (t = 0; t < NTRACKS; t++)
+          if (ipos[t] < ilen[t] && (m < 0 || iv[t][ipos[t]] < iv[m][ipos[m]]))
+            m = t;
+        if (m < 0)
+          break;
+        b = iv[m][ipos[m]];
+        e = iv[m][ipos[m]+1];
+        ipos[m] += 2;
+        if (cb >= 0 && b <= ce)
+          { if (e > ce)
+              ce = e;
+          }
+        else
+          { if (cb >= 0)
+              { data[dtop++] = cb;
+                data[dtop++] = ce;
+                if (VERBOSE)
+                  { parm->masked += ce-cb;
+                    parm->nmasks += 1;
+                  }
+              }
+            cb = b;
+            ce = e;
+          }
+      }
+    if (cb >= 0)
+      { data[dtop++] = cb;
+        data[dtop++] = ce;
+        if (VERBOSE)
+          { parm->masked += ce-cb;
+            parm->nmasks += 1;
+          }
+      }
+  }
+
+  parm->ints[aread-parm->rbeg] = dtop - parm->dtop;
+  parm->dtop = dtop;
+}
+
+static void *union_thread(void *arg)
+{ Union_Arg *parm = (Union_Arg *) arg;
+  int        j;
+
+  if (parm->rend - parm->rbeg > parm->imax)
+    { parm->imax = 1.2*(parm->rend-parm->rbeg) + 1000;
+      parm->ints = (int *) Realloc(parm->ints,sizeof(int)*parm->imax,"Expanding read index");
+      if (parm->ints == NULL)
+        exit (1);
+    }
+
+  parm->dtop = 0;
+  for (j = parm->rbeg; j < parm->rend; j++)
+    UNION(parm,j);
+  return (NULL);
+}
+
+  //  The reads are merged in batches of BATCH_READS so the memory used is bounded
+
+#define BATCH_READS  100000
+
+  //  Write the intervals found by parm[0..nparm) to the track files in read order
+
+static void write_batch(Union_Arg *parm, int nparm)
+{ int i, j, d, n;
+
+  for (i = 0; i < nparm; i++)
+    { d = 0;
+      for (j = parm[i].rbeg; j < parm[i].rend; j++)
+        { n = parm[i].ints[j-parm[i].rbeg];
+          Add_Track_Read(UN_TRACK,parm[i].data+d,n);
+          d += n;
+        }
+    }
+}
+
+  //  Merge each successive batch of reads with NTHREADS threads, each taking an equal share
+
+static void make_a_pass(Union_Arg *parm)
+{ THREAD threads[NTHREADS];
+  int    rbeg, rend, n;
+  int    i;
+
+  for (rbeg = 0; rbeg < DB->nreads; rbeg = rend)
+    { rend = rbeg + BATCH_READS;
+      if (rend > DB->nreads)
+        rend = DB->nreads;
+      n = rend-rbeg;
+
+      for (i = 0; i < NTHREADS; i++)
+        { parm[i].rbeg = rbeg + (int) ((((int64) n)*i)/NTHREADS);
+          parm[i].rend = rbeg + (int) ((((int64) n)*(i+1))/NTHREADS);
+        }
+
+      for (i = 0; i < NTHREADS; i++)
+        pthread_create(threads+i,NULL,union_thread,parm+i);
+      for (i = 0; i < NTHREADS; i++)
+        pthread_join(threads[i],NULL);
+
+      write_batch(parm,NTHREADS);
+    }
+}
+
+int main(int argc, char *argv[])
+{ char      *MASK_NAME;
+  Union_Arg *parm;
+
+  //  Process arguments
+
+  { int  i, j, k;
+    int  flags[128];
+    char *eptr;
+
+    ARG_INIT("UNIONmask")
+
+    MASK_NAME = "union";
+    NTHREADS  = 4;
+
+    j = 1;
+    for (i = 1; i < argc; i++)
+      if (argv[i][0] == '-')
+        switch (argv[i][1])
+        { default:
+            ARG_FLAGS("v")
+            break;
+          case 'n':
+            MASK_NAME = argv[i]+2;
+            break;
+          case 'T':
+            ARG_POSITIVE(NTHREADS,"Number of threads")
+            break;
+        }
+      else
+        argv[j++] = argv[i];
+    argc = j;
+
+    VERBOSE = flags['v'];
+
+    if (argc < 3)
+      { fprintf(stderr,"Usage: %s %s\n",Prog_Name,Usage);
+        fprintf(stderr,"\n");
+        fprintf(stderr,"      -v: Verbose mode, output coverage of each track and the union.\n");
+        fprintf(stderr,"      -n: use this name for the union mask track\n");
+        fprintf(stderr,"      -T: use -T threads.\n");
+        exit (1);
+      }
+  }
+
+  //  Open the DB or block, and map the data of each of its input tracks
+
+  if (Open_DB(argv[1],DB) < 0)
+    exit (1);
+  Trim_DB(DB);
+
+  NTRACKS = argc-2;
+  TRACKS  = (DAZZ_TRACK **) Malloc(sizeof(DAZZ_TRACK *)*NTRACKS,"Allocating track vector");
+  if (TRACKS == NULL)
+    exit (1);
+
+  { int t;
+
+    for (t = 0; t < NTRACKS; t++)
+      { if (strcmp(argv[t+2],MASK_NAME) == 0)
+          { fprintf(stderr,"%s: Union track cannot be an input track %s\n",Prog_Name,MASK_NAME);
+            exit (1);
+          }
+        TRACKS[t] = Open_Track(DB,argv[t+2]);
+        if (TRACKS[t] == NULL)
+          { fprintf(stderr,"%s: Track %s does not exist for %s\n",Prog_Name,argv[t+2],argv[1]);
+            exit (1);
+          }
+        if (TRACKS[t]->data == NULL)
+          { fprintf(stderr,"%s: Track %s is not an interval track\n",Prog_Name,argv[t+2]);
+            exit (1);
+          }
+        if (Map_All_Track_Data(TRACKS[t]))
+          exit (1);
+      }
+  }
+
+  //  Allocate thread work areas
+
+  parm = (Union_Arg *) Malloc(sizeof(Union_Arg)*NTHREADS,"Allocating thread records");
+  if (parm == NULL)
+    exit (1);
+  memset(parm,0,sizeof(Union_Arg)*NTHREADS);
+
+  { int i;
+
+    for (i = 0; i < NTHREADS; i++)
+      { parm[i].iv    = (int **) Malloc(sizeof(int *)*NTRACKS,"Allocating thread records");
+        parm[i].ilen  = (int *) Malloc(sizeof(int)*2*NTRACKS,"Allocating thread records");
+        parm[i].tmask = (int64 *) Malloc(sizeof(int64)*2*NTRACKS,"Allocating thread records");
+        if (parm[i].iv == NULL || parm[i].ilen == NULL || parm[i].tmask == NULL)
+          exit (1);
+        parm[i].ipos  = parm[i].ilen + NTRACKS;
+        parm[i].tbase = parm[i].tmask + NTRACKS;
+        memset(parm[i].tmask,0,sizeof(int64)*2*NTRACKS);
+      }
+  }
+
+  if (VERBOSE)
+    { int i;
+
+      printf("\nUNIONmask -n%s %s",MASK_NAME,argv[1]);
+      for (i = 2; i < argc; i++)
+        printf(" %s",argv[i]);
+      printf("\n");
+    }
+
+  //  Set up the union track for the DB or block
+
+  if (DB->part > 0)
+    UN_TRACK = Open_Track_Writer(Catenate(DB->path,Numbered_Suffix(".",DB->part,""),"",""),
+                                 MASK_NAME);
+  else
+    UN_TRACK = Open_Track_Writer(DB->path,MASK_NAME);
+
+  //  Merge the tracks of each read
+
+  make_a_pass(parm);
+
+  Close_Track_Writer(UN_TRACK);
+
+  if (VERBOSE)
+    { int64 nreads, totlen;
+      int64 nmasks, masked;
+      int   i, t;
+
+      nreads = DB->nreads;
+      totlen = DB->totlen;
+
+      printf("\nInput:    ");
+      Print_Number(nreads,7,stdout);
+      printf(" (100.0%%) reads     ");
+      Print_Number(totlen,12,stdout);
+      printf(" (100.0%%) bases\n");
+
+      for (t = 0; t <= NTRACKS; t++)
+        { nmasks = masked = 0;
+          for (i = 0; i < NTHREADS; i++)
+            if (t < NTRACKS)
+              { nmasks += parm[i].tmask[t];
+                masked += parm[i].tbase[t];
+              }
+            else
+              { nmasks += parm[i].nmasks;
+                masked += parm[i].masked;
+              }
+          printf("%-10.10s",t < NTRACKS ? TRACKS[t]->name : MASK_NAME);
+          Print_Number(nmasks,7,stdout);
+          printf(" (%5.1f%%) masks     ",(100.*nmasks)/nreads);
+          Print_Number(masked,12,stdout);
+          printf(" (%5.1f%%) bases\n",(100.*masked)/totlen);
+        }
+    }
+
+  { int i;
+
+    for (i = 0; i < NTHREADS; i++)
+      { free(parm[i].data);
+        free(parm[i].ints);
+        free(parm[i].iv);
+        free(parm[i].ilen);
+        free(parm[i].tmask);
+      }
+    free(parm);
+  }
+
+  free(TRACKS);
+  Close_DB(DB);
+  free(Prog_Name);
+
+  exit (0);
+}
@@ -3236,6 +3236,388 @@ int Check_Trace_Points(Overlap *ovl, int tspace, int verbose, char *fname)
 }
 
 
+/****************************************************************************************\
+*                                                                                        *
+*  COMPACT (VERSION 2) .LAS FILES                                                        *
+*                                                                                        *
+\****************************************************************************************/
+
+#define LAS2_HEADER  (2*sizeof(int64) + 2*sizeof(int))
+#define LAS2_MAXBUF  0x10000000     //  Largest block a reader accepts (a writer's exceed
+                                    //    LAS2_BLOCK only by a single LA)
+
+#define ZIG(v)    ((((uint32) (v)) << 1) ^ ((uint32) ((v) >> 31)))
+#define UNZIG(x)  ((int) (((x) >> 1) ^ (-((x) & 0x1))))
+
+#define PUT_VAR(p,v)                 \
+  { uint32 _x = (v);                 \
+    while (_x >= 0x80)               \
+      { *p++ = (uint8) (_x | 0x80);  \
+        _x >>= 7;                    \
+      }                              \
+    *p++ = (uint8) _x;               \
+  }
+
+Las2_File *Open_Las2_Writer(FILE *output, int tspace)
+{ Las2_File *las;
+  int64      head[2];
+  int        h2[2];
+
+  las = (Las2_File *) Malloc(sizeof(Las2_File),"Allocating .las writer");
+  if (las == NULL)
+    EXIT(NULL);
+  las->bmax = LAS2_BLOCK + 1000;
+  las->buf  = (uint8 *) Malloc(las->bmax,"Allocating .las writer");
+  if (las->buf == NULL)
+    { free(las);
+      EXIT(NULL);
+    }
+  las->file   = output;
+  las->novl   = 0;
+  las->tspace = tspace;
+  las->error  = 0;
+  las->btop   = las->bptr = 0;
+  las->count  = 0;
+  las->aread  = las->bread = 0;
+  las->tmax   = 0;
+  las->trace  = NULL;
+
+  head[0] = LAS2_MAGIC;
+  head[1] = 0;
+  h2[0]   = tspace;
+  h2[1]   = 0;
+  if (fwrite(head,sizeof(int64),2,output) != 2 || fwrite(h2,sizeof(int),2,output) != 2)
+    { free(las->buf);
+      free(las);
+      EXIT(NULL);
+    }
+  return (las);
+}
+
+static int las2_flush(Las2_File *las)
+{ uint32 head[2];
+
+  if (las->count == 0)
+    return (0);
+  head[0] = las->btop;
+  head[1] = las->count;
+  if (fwrite(head,sizeof(uint32),2,las->file) != 2)
+    return (1);
+  if (fwrite(las->buf,1,las->btop,las->file) != (size_t) las->btop)
+    return (1);
+  las->btop  = 0;
+  las->count = 0;
+  las->aread = las->bread = 0;
+  return (0);
+}
+
+int Write_Overlap2(Las2_File *las, Overlap *ovl, int tbytes)
+{ Path  *path = &(ovl->path);
+  int    tspace = las->tspace;
+  int    tlen, need, i;
+  uint8 *p;
+
+  tlen = path->trace != NULL ? path->tlen : 0;
+  need = 5*10 + 4*tlen;     //  An escaped trace point takes at most 1+3+3 bytes for 2 values
+  if (las->btop > 0 && las->btop + need > LAS2_BLOCK)
+    if (las2_flush(las))
+      return (1);
+  if (las->btop + need > las->bmax)
+    { las->bmax = 1.2*(las->btop+need) + 1000;
+      las->buf  = (uint8 *) Realloc(las->buf,las->bmax,"Expanding .las block");
+      if (las->buf == NULL)
+        EXIT(1);
+    }
+
+  p = las->buf + las->btop;
+  PUT_VAR(p,ZIG(ovl->aread - las->aread))
+  if (ovl->aread != las->aread)
+    las->bread = 0;
+  PUT_VAR(p,ZIG(ovl->bread - las->bread))
+  PUT_VAR(p,ovl->flags)
+  PUT_VAR(p,path->abpos)
+  PUT_VAR(p,ZIG(path->aepos - path->abpos))
+  PUT_VAR(p,path->bbpos)
+  PUT_VAR(p,ZIG(path->bepos - path->bbpos))
+  PUT_VAR(p,path->diffs)
+  PUT_VAR(p,tlen)
+  { uint8  *t8  = (uint8 *) path->trace;
+    uint16 *t16 = (uint16 *) path->trace;
+    uint32  d, b;
+
+    for (i = 1; i < tlen; i += 2)
+      { if (tbytes == 1)
+          { d = t8[i-1];
+            b = ZIG(t8[i] - tspace);
+          }
+        else
+          { d = t16[i-1];
+            b = ZIG(t16[i] - tspace);
+          }
+        if (d < 0xf && b <= 0xf)
+          *p++ = (uint8) ((d << 4) | b);
+        else
+          { *p++ = 0xf0;
+            PUT_VAR(p,d)
+            PUT_VAR(p,b)
+          }
+      }
+    if (i == tlen)
+      PUT_VAR(p,tbytes == 1 ? t8[i-1] : t16[i-1])
+  }
+
+  las->btop   = p - las->buf;
+  las->aread  = ovl->aread;
+  las->bread  = ovl->bread;
+  las->count += 1;
+  las->novl  += 1;
+  return (0);
+}
+
+int Close_Las2_Writer(Las2_File *las)
+{ int err;
+
+  err = las2_flush(las);
+  if (err == 0)
+    { err = (fseeko(las->file,sizeof(int64),SEEK_SET) < 0);
+      if (err == 0)
+        err = (fwrite(&(las->novl),sizeof(int64),1,las->file) != 1);
+      fseeko(las->file,0,SEEK_END);
+    }
+  free(las->buf);
+  free(las);
+  return (err);
+}
+
+Las2_File *Open_Las2_Reader(FILE *input)
+{ Las2_File *las;
+  int64      head[2];
+  int        h2[2];
+  off_t      pos;
+
+  pos = ftello(input);
+  if (fread(head,sizeof(int64),1,input) != 1 || head[0] != LAS2_MAGIC)
+    { fseeko(input,pos,SEEK_SET);
+      return (NULL);
+    }
+  if (fread(head+1,sizeof(int64),1,input) != 1 || fread(h2,sizeof(int),2,input) != 2)
+    { fseeko(input,pos,SEEK_SET);
+      return (NULL);
+    }
+
+  las = (Las2_File *) Malloc(sizeof(Las2_File),"Allocating .las reader");
+  if (las == NULL)
+    EXIT(NULL);
+  las->file   = input;
+  las->novl   = head[1];
+  las->tspace = h2[0];
+  las->error  = 0;
+  las->bmax   = 0;
+  las->buf    = NULL;
+  las->btop   = las->bptr = 0;
+  las->count  = 0;
+  las->aread  = las->bread = 0;
+  las->tmax   = 0;
+  las->trace  = NULL;
+  return (las);
+}
+
+static inline int get_var(Las2_File *las, uint32 *v)
+{ uint8 *p = las->buf + las->bptr;
+  uint8 *e = las->buf + las->btop;
+  uint32 x;
+  int    s;
+
+  x = 0;
+  for (s = 0; p < e && s < 35; s += 7)
+    { x |= ((uint32) (*p & 0x7f)) << s;
+      if (*p++ < 0x80)
+        { *v = x;
+          las->bptr = p - las->buf;
+          return (0);
+        }
+    }
+  return (1);
+}
+
+#define GET_VAR(v)                \
+  { if (get_var(las,&(v)))        \
+      goto corrupt;               \
+  }
+
+int Read_Overlap2(Las2_File *las, Overlap *ovl)
+{ Path  *path = &(ovl->path);
+  uint32 x;
+  int    i, tspace;
+
+  if (las->count == 0)
+    { uint32 head[2];
+
+      if (fread(head,sizeof(uint32),2,las->file) != 2)
+        { if (ferror(las->file))
+            las->error = 1;
+          return (1);
+        }
+      if (head[0] > LAS2_MAXBUF || head[1] == 0 || head[1] > head[0])
+        goto corrupt;
+      if ((int) head[0] > las->bmax)
+        { las->bmax = 1.2*head[0] + 1000;
+          las->buf  = (uint8 *) Realloc(las->buf,las->bmax,"Allocating .las block");
+          if (las->buf == NULL)
+            EXIT(1);
+        }
+      if (fread(las->buf,1,head[0],las->file) != head[0])
+        goto corrupt;
+      las->btop  = head[0];
+      las->bptr  = 0;
+      las->count = head[1];
+      las->aread = las->bread = 0;
+    }
+
+  GET_VAR(x)
+  ovl->aread = las->aread + UNZIG(x);
+  if (ovl->aread != las->aread)
+    las->bread = 0;
+  GET_VAR(x)
+  ovl->bread = las->bread + UNZIG(x);
+  GET_VAR(x)
+  ovl->flags = x;
+  GET_VAR(x)
+  path->abpos = x;
+  GET_VAR(x)
+  path->aepos = path->abpos + UNZIG(x);
+  GET_VAR(x)
+  path->bbpos = x;
+  GET_VAR(x)
+  path->bepos = path->bbpos + UNZIG(x);
+  GET_VAR(x)
+  path->diffs = x;
+  GET_VAR(x)
+  if (x > 2*((uint32) (las->btop - las->bptr)) + 1)    //  A trace point pair takes a byte
+    goto corrupt;
+  path->tlen = x;
+
+  if (path->tlen > las->tmax)
+    { las->tmax  = 1.2*path->tlen + 100;
+      las->trace = (int *) Realloc(las->trace,sizeof(int)*las->tmax,"Allocating trace vector");
+      if (las->trace == NULL)
+        EXIT(1);
+    }
+  tspace = las->tspace;
+  for (i = 1; i < path->tlen; i += 2)
+    { if (las->bptr >= las->btop)
+        goto corrupt;
+      x = las->buf[las->bptr++];
+      if (x < 0xf0)
+        { las->trace[i-1] = (x >> 4);
+          las->trace[i]   = UNZIG(x & 0xf) + tspace;
+        }
+      else
+        { GET_VAR(x)
+          las->trace[i-1] = x;
+          GET_VAR(x)
+          las->trace[i] = UNZIG(x) + tspace;
+        }
+    }
+  if (i == path->tlen)
+    { GET_VAR(x)
+      las->trace[i-1] = x;
+    }
+
+  las->aread  = ovl->aread;
+  las->bread  = ovl->bread;
+  las->count -= 1;
+  return (0);
+
+corrupt:
+  EPRINTF(EPLACE,"%s: Corrupt block in compact .las file\n",Prog_Name);
+  las->error = 1;
+  return (1);
+}
+
+int Read_Trace2(Las2_File *las, Overlap *ovl, int tbytes)
+{ int i;
+
+  if (tbytes == 1)
+    { uint8 *t8 = (uint8 *) ovl->path.trace;
+      for (i = 0; i < ovl->path.tlen; i++)
+        t8[i] = (uint8) las->trace[i];
+    }
+  else if (tbytes == 2)
+    { uint16 *t16 = (uint16 *) ovl->path.trace;
+      for (i = 0; i < ovl->path.tlen; i++)
+        t16[i] = (uint16) las->trace[i];
+    }
+  return (0);
+}
+
+void Close_Las2_Reader(Las2_File *las)
+{ free(las->trace);
+  free(las->buf);
+  free(las);
+}
+
+int64 Compact_Las(FILE *input, char *iname, FILE *output, char *oname)
+{ Las2_File *las;
+  Overlap    ovl;
+  int64      novl, j;
+  int        tspace, tbytes, tmax;
+  void      *trace;
+
+  if (fread(&novl,sizeof(int64),1,input) != 1 || fread(&tspace,sizeof(int),1,input) != 1
+                                              || novl == LAS2_MAGIC)
+    { EPRINTF(EPLACE,"%s: %s is not a classic .las file\n",Prog_Name,iname);
+      EXIT(-1);
+    }
+  if (tspace <= TRACE_XOVR)
+    tbytes = sizeof(uint8);
+  else
+    tbytes = sizeof(uint16);
+
+  las = Open_Las2_Writer(output,tspace);
+  if (las == NULL)
+    goto write_error;
+
+  tmax  = 0;
+  trace = NULL;
+  for (j = 0; j < novl; j++)
+    { if (Read_Overlap(input,&ovl))
+        goto truncated;
+      if (ovl.path.tlen > tmax)
+        { tmax  = 1.2*ovl.path.tlen + 100;
+          trace = Realloc(trace,tmax*sizeof(uint16),"Allocating trace vector");
+          if (trace == NULL)
+            { Close_Las2_Writer(las);
+              EXIT(-1);
+            }
+        }
+      ovl.path.trace = trace;
+      if (Read_Trace(input,&ovl,tbytes))
+        goto truncated;
+      if (Write_Overlap2(las,&ovl,tbytes))
+        { free(trace);
+          Close_Las2_Writer(las);
+          goto write_error;
+        }
+    }
+  free(trace);
+
+  if (Close_Las2_Writer(las))
+    goto write_error;
+  return (novl);
+
+truncated:
+  free(trace);
+  Close_Las2_Writer(las);
+  EPRINTF(EPLACE,"%s: %s is truncated\n",Prog_Name,iname);
+  EXIT(-1);
+
+write_error:
+  EPRINTF(EPLACE,"%s: Write of %s failed\n",Prog_Name,oname);
+  EXIT(-1);
+}
+
+
 void Flip_Alignment(Alignment *align, int full)
 { char *aseq  = align->aseq;
   char *bseq  = align->bseq;
@@ -375,6 +375,63 @@ typedef struct {
 
   int  Check_Trace_Points(Overlap *ovl, int tspace, int verbose, char *fname);
 
+  /* A compact (version 2) .las file begins with LAS2_MAGIC, the number of LAs, and the trace
+     spacing, followed by blocks each holding up to LAS2_BLOCK bytes of encoded LAs.  A block
+     begins with its size in bytes and the number of LAs in it, and can be decoded on its own.
+     Within a block the A-read of an LA is coded as the difference from the previous LA's,
+     the B-read as the difference from the previous B-read of the same A-read, and the
+     coordinates and diffs as variable length integers (varints of 7-bit groups, signed
+     values being zig-zag coded).  Each trace point, a diff count and a B-displacement, is
+     coded in one byte when the count is less than 15 and the displacement is within 8 of
+     the trace spacing, and otherwise as 0xf0 followed by the two values as varints.
+
+     Open_Las2_Writer writes the header of a version 2 .las file to 'output' for trace spacing
+     'tspace' and returns a handle for Write_Overlap2, which encodes 'ovl' and its trace of
+     'tbytes' bytes per value.  Close_Las2_Writer writes the last block and fills in the
+     number of LAs in the header.  They return non-zero (resp. NULL) on a write error.
+
+     Open_Las2_Reader reads the header of 'input' and returns a handle for reading it if it
+     is a version 2 file, and otherwise leaves 'input' where it was and returns NULL.
+     Read_Overlap2 and Read_Trace2 then read the file exactly as Read_Overlap and Read_Trace
+     do a classic one, returning non-zero at the end of the file or on a corrupt block
+     (distinguished by the 'error' field).  Close_Las2_Reader frees the handle, 'input' is
+     not closed by either Close routine.
+
+     Compact_Las writes the classic .las file 'input' to 'output' in the compact format and
+     returns the number of LAs, or -1 if 'input' is not a classic .las file, is truncated,
+     or the write fails (iname and oname are used for error messages only).  Open_Piles
+     (pile.h) reads either format, so TANmask and REPmask take compact files as well.
+  */
+
+#define LAS2_MAGIC  0x7832534c417a6144ll   //  "DazLAS2x"
+#define LAS2_BLOCK  0x100000
+
+typedef struct
+  { FILE   *file;
+    int64   novl;       /* # of LAs in the file (read) or written so far      */
+    int     tspace;     /* Trace spacing                                      */
+    int     error;      /* Set if a read error or corrupt block was found     */
+    uint8  *buf;        /* Current block, buf[0..btop), next byte at bptr     */
+    int     bmax;
+    int     btop, bptr;
+    int     count;      /* # of LAs left to read in (written to) the block    */
+    int     aread;      /* A- and B-read of the last LA coded in the block    */
+    int     bread;
+    int     tmax;       /* Trace of the last LA read, trace[0..tlen)          */
+    int    *trace;
+  } Las2_File;
+
+  Las2_File *Open_Las2_Writer(FILE *output, int tspace);
+  int        Write_Overlap2(Las2_File *las, Overlap *ovl, int tbytes);
+  int        Close_Las2_Writer(Las2_File *las);
+
+  Las2_File *Open_Las2_Reader(FILE *input);
+  int        Read_Overlap2(Las2_File *las, Overlap *ovl);
+  int        Read_Trace2(Las2_File *las, Overlap *ovl, int tbytes);
+  void       Close_Las2_Reader(Las2_File *las);
+
+  int64      Compact_Las(FILE *input, char *iname, FILE *output, char *oname);
+
   /* Gap_Improver takes an alignment trace and improves it so the alignment has fewer, larger
      gaps as if computed under an affine gap penalty.  It should be called immediately after
      Compute_Trace_(PTS|MID).  The modified trace alignment is guaranteed to have the same
@@ -16,6 +16,10 @@
  *    XXX.XXX.T#.las where # is the thread that detected and wrote out the collection of LAs.
  *    For example, if NTHREAD in the program is 4, then 4 files are output for each subject block.
  *
+ *    A subject may also be a FASTA or FASTQ file (possibly gzip'd), or - for the standard
+ *    input, in which case it is read and compared in batches without building a DB, and with
+ *    -i the resulting tandem intervals are output in a BED file.
+ *
  *  Author:  Gene Myers
  *  Date  :  March 27, 2016
  *
@@ -29,6 +33,7 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <dirent.h>
 
 #include <sys/param.h>
@@ -38,17 +43,23 @@
 
 #include "DB.h"
 #include "tandem.h"
+#include "pile.h"
 
 static char *Usage[] =
-  { "[-v] [-k<int(12)>] [-w<int(4)>] [-h<int(35)>] [-T<int(4)>] [-P<dir(/tmp)>]",
-    "     [-e<double(.70)] [-l<int(500)>] [-s<int(100)>] <subject:db|dam> ...",
+  { "[-vcSuz] [-k<int(12)>] [-w<int(4)>] [-h<int(35)>] [-T<int(4)>] [-P<dir(/tmp)>]",
+    "     [-e<double(.70)] [-l<int(500)>] [-s<int(100)>] [-p<int(50000)>] [-o<int(10000)>]",
+    "     [-t<int>] [-r<int>] [-i] [-B<int(200)>] <subject:db|dam|fasta|fastq> ...",
   };
 
 int     VERBOSE;   //   Globally visible to tandem.c
 char   *SORT_PATH;
 int     MINOVER;
+int     PANEL_SIZE;
+int     PANEL_OVERLAP;
+
+static int COMPACT;   //  Write each TAN .las file in the compact format of align.h (-z)
 
-static int read_DB(DAZZ_DB *block, char *name, int kmer)
+static int read_DB(DAZZ_DB *block, char *name, int kmer, int packed, int shared, int nthreads)
 { int i, isdam;
 
   isdam = Open_DB(name,block);
@@ -66,7 +77,12 @@ static int read_DB(DAZZ_DB *block, char *name, int kmer)
           }
     }
 
-  Load_All_Reads(block,0);
+  if (packed)
+    Map_All_Reads(block);
+  else if (shared)
+    Share_All_Reads(block,0);
+  else
+    Load_All_Reads_Threaded(block,0,nthreads);
 
   return (isdam);
 }
@@ -100,6 +116,537 @@ void Clean_Exit(int val)
   exit (val);
 }
 
+  //  Sort and merge the thread .las files for aname produced by Match_Self into TAN.aname.las
+
+#define SYSTEM_CHECK(command)                                           \
+ if (VERBOSE)                                                           \
+   printf("%s\n",command);                                              \
+ if (system(command) != 0)                                              \
+   { fprintf(stderr,"\n%s: Command Failed:\n%*s      %s\n",             \
+                    Prog_Name,(int) strlen(Prog_Name),"",command);      \
+     Clean_Exit(1);                                                     \
+   }
+
+static void sort_and_merge(char *aname)
+{ char *command;
+
+  command = CommandBuffer(aname,SORT_PATH);
+
+  sprintf(command,"LAsort %s/%s.T%c.las",SORT_PATH,aname,BLOCK_SYMBOL);
+  SYSTEM_CHECK(command)
+
+  sprintf(command,"LAmerge TAN.%s.las %s/%s.T%c.S.las",aname,SORT_PATH,aname,BLOCK_SYMBOL);
+  SYSTEM_CHECK(command)
+
+  //  With -z rewrite the merged file in the compact format (the thread files stay classic
+  //    as LAsort and LAmerge only read that)
+
+  if (COMPACT)
+    { FILE *input, *output;
+      char *path, *temp;
+
+      path   = Strdup(Catenate("TAN.",aname,".las",""),"Allocating file name");
+      temp   = Strdup(Catenate("TAN.",aname,".las",".z"),"Allocating file name");
+      if (path == NULL || temp == NULL)
+        Clean_Exit(1);
+      input  = Fopen(path,"r");
+      output = Fopen(temp,"w");
+      if (input == NULL || output == NULL)
+        Clean_Exit(1);
+      if (Compact_Las(input,path,output,temp) < 0)
+        { unlink(temp);
+          Clean_Exit(1);
+        }
+      fclose(input);
+      if (fclose(output) != 0 || rename(temp,path) < 0)
+        { fprintf(stderr,"%s: Could not replace %s with its compact form\n",Prog_Name,path);
+          unlink(temp);
+          Clean_Exit(1);
+        }
+      if (VERBOSE)
+        printf("Compacted %s\n",path);
+      free(temp);
+      free(path);
+    }
+
+  //  Index the piles of the merged file for the masking tools (see LAindex)
+
+  { Las_Index *index;
+    FILE      *input;
+    char      *path;
+
+    path  = Catenate("TAN.",aname,".las","");
+    input = Fopen(path,"r");
+    if (input == NULL)
+      Clean_Exit(1);
+    index = Build_Las_Index(input,path);
+    if (index == NULL || Write_Las_Index(index,path))
+      Clean_Exit(1);
+    Free_Las_Index(index);
+    fclose(input);
+  }
+}
+
+
+/*******************************************************************************************
+ *
+ *  STREAMING FASTA/FASTQ INPUT
+ *
+ *  A .fasta/.fa/.fastq/.fq file, optionally gzip'd (decompressed by a gzip child process), or
+ *    the standard input (named -), is read in batches of roughly BATCH_SIZE bases, each of
+ *    which is set up in memory as a DB block and compared against itself.  The output for
+ *    each batch is either a .las file as for a DB block, or with -i, the tandem intervals
+ *    that TANmask would find are written directly to a BED file.
+ *
+ ********************************************************************************************/
+
+#define SEP_FUZZ 20       //  As in TANmask
+
+static int   BED_OUT;     //  Output BED intervals instead of .las files
+static int64 BATCH_SIZE;  //  Bases per streamed batch
+static int   MASK_LEN;    //  Minimum length of a BED interval (TANmask's -l)
+
+static char *Seq_Suffix[] = { ".fasta", ".fa", ".fastq", ".fq" };
+
+#define NUM_SEQ_SUFFIX  4
+
+typedef struct
+  { char   *name;     //  Name of the input
+    FILE   *input;    //  Stream (pipe from gzip if pid > 0)
+    pid_t   pid;
+    char   *line;     //  Current line (valid if llen >= 0)
+    size_t  lmax;
+    ssize_t llen;
+    int64   lnum;     //  Line number of current line
+    uint32  seed;     //  Pseudo-random state for replacing non-ACGT symbols
+  } Seq_Stream;
+
+  //  Return the root name if name is a streamable sequence file (or -), and NULL otherwise
+
+static char *Stream_Root(char *name)
+{ char *root;
+  int   i, len, slen;
+
+  if (strcmp(name,"-") == 0)
+    return (Strdup("stdin","Allocating stream name"));
+
+  root = Root(name,".gz");
+  len  = strlen(root);
+  for (i = 0; i < NUM_SEQ_SUFFIX; i++)
+    { slen = strlen(Seq_Suffix[i]);
+      if (len > slen && strcmp(root+(len-slen),Seq_Suffix[i]) == 0)
+        { root[len-slen] = '\0';
+          return (root);
+        }
+    }
+  free(root);
+  return (NULL);
+}
+
+static int next_line(Seq_Stream *s)
+{ s->llen = getline(&(s->line),&(s->lmax),s->input);
+  if (s->llen < 0)
+    return (1);
+  while (s->llen > 0 && isspace(s->line[s->llen-1]))
+    s->llen -= 1;
+  s->line[s->llen] = '\0';
+  s->lnum += 1;
+  return (0);
+}
+
+static Seq_Stream *Open_Stream(char *name)
+{ Seq_Stream *s;
+  int         len;
+
+  s = (Seq_Stream *) Malloc(sizeof(Seq_Stream),"Allocating stream");
+  if (s == NULL)
+    Clean_Exit(1);
+  s->name   = name;
+  s->line   = NULL;
+  s->lmax   = 0;
+  s->lnum   = 0;
+  s->seed   = 0x1234567;
+  s->pid    = 0;
+
+  //  A gzip'd file is decompressed by gzip -dc run directly (not through a shell), so that
+  //    the file name is passed to it verbatim
+
+  len = strlen(name);
+  if (strcmp(name,"-") == 0)
+    s->input = stdin;
+  else if (len > 3 && strcmp(name+(len-3),".gz") == 0)
+    { int fd[2];
+
+      s->input = NULL;
+      if (pipe(fd) == 0)
+        { s->pid = fork();
+          if (s->pid == 0)
+            { close(fd[0]);
+              if (dup2(fd[1],STDOUT_FILENO) < 0)
+                _exit(1);
+              close(fd[1]);
+              execlp("gzip","gzip","-dc","--",name,(char *) NULL);
+              _exit(1);
+            }
+          close(fd[1]);
+          if (s->pid > 0)
+            s->input = fdopen(fd[0],"r");
+          else
+            close(fd[0]);
+        }
+    }
+  else
+    s->input = fopen(name,"r");
+  if (s->input == NULL)
+    { fprintf(stderr,"%s: Cannot open %s for reading\n",Prog_Name,name);
+      Clean_Exit(1);
+    }
+
+  if (next_line(s))
+    s->llen = -1;
+  else if (s->line[0] != '>' && s->line[0] != '@')
+    { fprintf(stderr,"%s: %s is not a FASTA or FASTQ file\n",Prog_Name,name);
+      Clean_Exit(1);
+    }
+  return (s);
+}
+
+static void Close_Stream(Seq_Stream *s)
+{ if (s->pid > 0)
+    { int status;
+
+      fclose(s->input);
+      if (waitpid(s->pid,&status,0) < 0 || ! WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        { fprintf(stderr,"%s: Decompression of %s failed\n",Prog_Name,s->name);
+          Clean_Exit(1);
+        }
+    }
+  else if (s->input != stdin)
+    fclose(s->input);
+  free(s->line);
+  free(s);
+}
+
+  //  Read the next batch of sequences from s into block, whose reads are numbered from first.
+  //    The bases are uncompressed in memory exactly as after Load_All_Reads, and the name of
+  //    read i (the first word of its header) is at names + reads[i].coff.  Returns the number
+  //    of reads in the batch (0 at the end of the stream).
+
+static int Read_Batch(Seq_Stream *s, DAZZ_DB *block, int first, char **names)
+{ static char      *sbuf = NULL, *nbuf = NULL;
+  static int64      smax = 0, nmax = 0;
+  static DAZZ_READ *reads = NULL;
+  static int        rmax = 0;
+
+  static char code[128];
+  static int  isinit = 0;
+
+  int64 stop, ntop;
+  int   nreads, maxlen;
+  int   fastq;
+
+  if (!isinit)
+    { int i;
+
+      for (i = 0; i < 128; i++)
+        code[i] = 4;
+      code['a'] = code['A'] = 0;
+      code['c'] = code['C'] = 1;
+      code['g'] = code['G'] = 2;
+      code['t'] = code['T'] = 3;
+      isinit = 1;
+    }
+
+  if (sbuf == NULL)
+    { smax = BATCH_SIZE + 1000000;
+      sbuf = (char *) Malloc(smax,"Allocating batch");
+      nmax = 100000;
+      nbuf = (char *) Malloc(nmax,"Allocating batch");
+      rmax = 10000;
+      reads = (DAZZ_READ *) Malloc(sizeof(DAZZ_READ)*(rmax+2),"Allocating batch");
+      if (sbuf == NULL || nbuf == NULL || reads == NULL)
+        Clean_Exit(1);
+      sbuf[0] = 4;
+    }
+
+  stop   = 1;
+  ntop   = 0;
+  nreads = 0;
+  maxlen = 0;
+  while (s->llen >= 0 && stop-1 < BATCH_SIZE)
+    { char  *h;
+      int64  beg;
+      int    len, i;
+
+      fastq = (s->line[0] == '@');
+      if (!fastq && s->line[0] != '>')
+        { fprintf(stderr,"%s: Line %lld of %s is not a header line\n",Prog_Name,s->lnum,s->name);
+          Clean_Exit(1);
+        }
+
+      if (nreads >= rmax)
+        { rmax  = 1.2*nreads + 1000;
+          reads = (DAZZ_READ *) Realloc(reads,sizeof(DAZZ_READ)*(rmax+2),"Allocating batch");
+          if (reads == NULL)
+            Clean_Exit(1);
+        }
+
+      for (h = s->line+1; *h != '\0' && !isspace(*h); h++)
+        ;
+      *h = '\0';
+      len = h - s->line;
+      if (ntop + len >= nmax)
+        { nmax = 1.2*(ntop+len) + 100000;
+          nbuf = (char *) Realloc(nbuf,nmax,"Allocating batch");
+          if (nbuf == NULL)
+            Clean_Exit(1);
+        }
+      strcpy(nbuf+ntop,s->line+1);
+      reads[nreads+1].coff = ntop;
+      ntop += len;
+
+      beg = stop;
+      while (1)
+        { if (next_line(s))
+            { s->llen = -1;
+              break;
+            }
+          if (s->line[0] == (fastq ? '+' : '>'))
+            break;
+          if (stop + s->llen + 1 >= smax)
+            { smax = 1.2*(stop + s->llen) + 1000000;
+              sbuf = (char *) Realloc(sbuf,smax,"Allocating batch");
+              if (sbuf == NULL)
+                Clean_Exit(1);
+            }
+          for (i = 0; i < s->llen; i++)
+            { int c = code[s->line[i] & 0x7f];
+              if (c == 4)
+                { s->seed = s->seed*1103515245 + 12345;
+                  c = (s->seed >> 16) & 0x3;
+                }
+              sbuf[stop++] = c;
+            }
+        }
+      len = stop-beg;
+      sbuf[stop++] = 4;
+
+      if (fastq)
+        { int64 qlen;
+
+          if (s->llen < 0)
+            { fprintf(stderr,"%s: Last FASTQ entry of %s is truncated\n",Prog_Name,s->name);
+              Clean_Exit(1);
+            }
+          for (qlen = 0; qlen < len; qlen += s->llen)
+            if (next_line(s))
+              { fprintf(stderr,"%s: Last FASTQ entry of %s is truncated\n",Prog_Name,s->name);
+                Clean_Exit(1);
+              }
+          if (next_line(s))
+            s->llen = -1;
+        }
+
+      reads[nreads+1].origin = nreads;
+      reads[nreads+1].rlen   = len;
+      reads[nreads+1].fpulse = 0;
+      reads[nreads+1].boff   = beg-1;
+      reads[nreads+1].flags  = DB_BEST;
+      nreads += 1;
+      if (len > maxlen)
+        maxlen = len;
+    }
+  reads[nreads+1].boff = stop-1;
+
+  block->ureads  = block->treads = nreads;
+  block->cutoff  = 0;
+  block->allarr  = DB_ALL;
+  block->freq[0] = block->freq[1] = block->freq[2] = block->freq[3] = .25;
+  block->maxlen  = maxlen;
+  block->totlen  = stop - (nreads+1);
+  block->nreads  = nreads;
+  block->trimmed = 1;
+  block->part    = 0;
+  block->ufirst  = block->tfirst = first;
+  block->path    = NULL;
+  block->loaded  = 1;
+  block->bases   = (void *) (sbuf+1);
+  block->reads   = reads+1;
+  block->tracks  = NULL;
+
+  *names = nbuf;
+  return (nreads);
+}
+
+static int ISORT(const void *l, const void *r)
+{ int x = *((int *) l);
+  int y = *((int *) r);
+  return (x-y);
+}
+
+  //  Output to bed the union of the self-overlapping LAs of a read, exactly as TANmask does
+
+static void bed_read(FILE *bed, char *name, Overlap *ovls, int novl, int *add, int *del,
+                     int64 *nints, int64 *nbps)
+{ int   i, j, x, b;
+  int   evnum;
+  Path *ipath;
+
+  evnum = 0;
+  for (i = 0; i < novl; i++)
+    { ipath = &(ovls[i].path);
+      if (ipath->abpos - ipath->bepos <= SEP_FUZZ)
+        { if (ipath->aepos - ipath->bbpos > MASK_LEN)
+            { add[evnum] = ipath->bbpos;
+              del[evnum] = ipath->aepos;
+              evnum += 1;
+            }
+        }
+    }
+  qsort(add,evnum,sizeof(int),ISORT);
+  qsort(del,evnum,sizeof(int),ISORT);
+
+  x = b = 0;
+  i = j = 0;
+  while (j < evnum)
+    if (i < evnum && add[i] <= del[j])
+      { if (x == 0)
+          b = add[i];
+        x += 1;
+        i += 1;
+      }
+    else
+      { x -= 1;
+        if (x == 0)
+          { fprintf(bed,"%s\t%d\t%d\n",name,b,del[j]);
+            *nints += 1;
+            *nbps  += del[j]-b;
+          }
+        j += 1;
+      }
+}
+
+  //  Output the BED intervals of every read of block with self-LAs in the thread .las files
+  //    produced by Match_Self for aname.  Each thread handles a disjoint, ascending range of
+  //    reads and writes the LAs of each read contiguously.
+
+static void Write_Bed(FILE *bed, char *aname, DAZZ_DB *block, char *names,
+                      int64 *nints, int64 *nbps)
+{ static Overlap *ovls = NULL;
+  static int     *add  = NULL;
+  static int      omax = 0;
+
+  FILE  *input;
+  int64  novl, j;
+  int    tspace, tbytes;
+  int    t, n;
+
+  for (t = 1; 1; t++)
+    { input = fopen(Catenate(SORT_PATH,"/",aname,Numbered_Suffix(".T",t,".las")),"r");
+      if (input == NULL)
+        break;
+      if (fread(&novl,sizeof(int64),1,input) != 1)
+        SYSTEM_READ_ERROR
+      if (fread(&tspace,sizeof(int),1,input) != 1)
+        SYSTEM_READ_ERROR
+      if (tspace <= TRACE_XOVR)
+        tbytes = sizeof(uint8);
+      else
+        tbytes = sizeof(uint16);
+
+      n = 0;
+      for (j = 0; j < novl; j++)
+        { if (n >= omax)
+            { omax = 1.2*n + 500;
+              ovls = (Overlap *) Realloc(ovls,sizeof(Overlap)*omax,"Allocating overlap buffer");
+              add  = (int *) Realloc(add,2*sizeof(int)*omax,"Allocating sort vector");
+              if (ovls == NULL || add == NULL)
+                Clean_Exit(1);
+            }
+          if (Read_Overlap(input,ovls+n) != 0)
+            SYSTEM_READ_ERROR
+          fseeko(input,tbytes*ovls[n].path.tlen,SEEK_CUR);
+          if (n > 0 && ovls[n].aread != ovls[0].aread)
+            { bed_read(bed,names+block->reads[ovls[0].aread-block->tfirst].coff,
+                       ovls,n,add,add+omax,nints,nbps);
+              ovls[0] = ovls[n];
+              n = 0;
+            }
+          n += 1;
+        }
+      if (n > 0)
+        bed_read(bed,names+block->reads[ovls[0].aread-block->tfirst].coff,
+                 ovls,n,add,add+omax,nints,nbps);
+
+      fclose(input);
+      unlink(Catenate(SORT_PATH,"/",aname,Numbered_Suffix(".T",t,".las")));
+    }
+}
+
+  //  Compare each batch of sequences in name against itself
+
+static void stream_self(char *name, char *root, Align_Spec *settings)
+{ DAZZ_DB     _block, *block = &_block;
+  Seq_Stream *s;
+  FILE       *bed;
+  char       *names, *aname;
+  int         first, nreads, b;
+  int64       nints, nbps;
+
+  s = Open_Stream(name);
+
+  bed = NULL;
+  if (BED_OUT)
+    { bed = Fopen(Catenate(".","/",root,".tan.bed"),"w");
+      if (bed == NULL)
+        Clean_Exit(1);
+    }
+
+  nints = nbps = 0;
+  first = 0;
+  for (b = 1; (nreads = Read_Batch(s,block,first,&names)) > 0; b++)
+    { if (b == 1 && s->llen < 0)
+        aname = Strdup(root,"Allocating batch name");
+      else
+        aname = Strdup(Catenate(root,Numbered_Suffix(".",b,""),"",""),"Allocating batch name");
+      if (aname == NULL)
+        Clean_Exit(1);
+
+      if (VERBOSE)
+        { printf("\nBatch %s: ",aname);
+          Print_Number((int64) nreads,0,stdout);
+          printf(" sequences, ");
+          Print_Number(block->totlen,0,stdout);
+          printf(" bases\n");
+          fflush(stdout);
+        }
+
+      Match_Self(aname,block,settings);
+
+      if (BED_OUT)
+        Write_Bed(bed,aname,block,names,&nints,&nbps);
+      else
+        sort_and_merge(aname);
+
+      first += nreads;
+      free(aname);
+    }
+
+  Close_Stream(s);
+
+  if (BED_OUT)
+    { fclose(bed);
+      if (VERBOSE)
+        { printf("\n%s.tan.bed: ",root);
+          Print_Number(nints,0,stdout);
+          printf(" tandem intervals covering ");
+          Print_Number(nbps,0,stdout);
+          printf(" bases\n");
+          fflush(stdout);
+        }
+    }
+}
+
 int main(int argc, char *argv[])
 { DAZZ_DB    _bblock;
   DAZZ_DB    *bblock = &_bblock;
@@ -107,14 +654,19 @@ int main(int argc, char *argv[])
   char       *broot;
   Align_Spec *settings;
   int         isdam;
-  char       *command;
 
   int    KMER_LEN;
   int    BIN_SHIFT;
   int    HIT_MIN;
+  int    MAX_REPS;
+  int    MAX_RREPS;
   double AVE_ERROR;
   int    SPACING;
   int    NTHREADS;
+  int    PACKED;
+  int    SHARED;
+  int    UNSHARE;
+  int    BATCH_MBP;
 
   { int    i, j, k;
     int    flags[128];
@@ -126,18 +678,25 @@ int main(int argc, char *argv[])
     KMER_LEN  = 12;
     HIT_MIN   = 35;
     BIN_SHIFT = 4;
+    MAX_REPS  = 0;
+    MAX_RREPS = 0;
     AVE_ERROR = .70;
     SPACING   = 100;
     MINOVER   = 500;    //   Globally visible to filter.c
     NTHREADS  = 4;
     SORT_PATH = "/tmp";
 
+    BATCH_MBP     = 200;
+
+    PANEL_SIZE    = 50000;   //   Globally visible to tandem.c
+    PANEL_OVERLAP = 10000;
+
     j    = 1;
     for (i = 1; i < argc; i++)
-      if (argv[i][0] == '-')
+      if (argv[i][0] == '-' && argv[i][1] != '\0')
         switch (argv[i][1])
         { default:
-            ARG_FLAGS("v")
+            ARG_FLAGS("vciSuz")
             break;
           case 'k':
             ARG_POSITIVE(KMER_LEN,"K-mer length")
@@ -166,6 +725,21 @@ int main(int argc, char *argv[])
           case 's':
             ARG_POSITIVE(SPACING,"Trace spacing")
             break;
+          case 't':
+            ARG_POSITIVE(MAX_REPS,"Tuple suppression frequency")
+            break;
+          case 'r':
+            ARG_POSITIVE(MAX_RREPS,"Tuple suppression frequency within a read")
+            break;
+          case 'B':
+            ARG_POSITIVE(BATCH_MBP,"Batch size (in Mbp)")
+            break;
+          case 'p':
+            ARG_POSITIVE(PANEL_SIZE,"Panel size")
+            break;
+          case 'o':
+            ARG_NON_NEGATIVE(PANEL_OVERLAP,"Panel overlap")
+            break;
           case 'P':
             SORT_PATH = argv[i]+2;
             if ((dirp = opendir(SORT_PATH)) == NULL)
@@ -183,29 +757,96 @@ int main(int argc, char *argv[])
     argc = j;
 
     VERBOSE = flags['v'];   //  Globally declared in filter.h
+    PACKED  = flags['c'];
+    SHARED  = flags['S'];
+    UNSHARE = flags['u'];
+    COMPACT = flags['z'];
+    BED_OUT = flags['i'];
 
     if (argc <= 1)
       { fprintf(stderr,"Usage: %s %s\n",Prog_Name,Usage[0]);
         fprintf(stderr,"       %*s %s\n",(int) strlen(Prog_Name),"",Usage[1]);
+        fprintf(stderr,"       %*s %s\n",(int) strlen(Prog_Name),"",Usage[2]);
         fprintf(stderr,"\n");
         fprintf(stderr,"      -v: Verbose mode, output statistics as proceed.\n");
+        fprintf(stderr,"      -c: Keep each block 2-bit compressed in a shared map of the .bps file.\n");
+        fprintf(stderr,"      -S: Share each loaded block with other jobs on the node.\n");
+        fprintf(stderr,"      -u: Remove the shared copies of the given blocks made with -S.\n");
+        fprintf(stderr,"      -z: Write each TAN .las file in the compact format of LAconvert.\n");
         fprintf(stderr,"      -k: k-mer size (must be <= 32).\n");
         fprintf(stderr,"      -w: Look for k-mers in averlapping bands of size 2^-w.\n");
         fprintf(stderr,"      -h: A seed hit if the k-mers in band cover >= -h bps in the");
         fprintf(stderr," targest read.\n");
+        fprintf(stderr,"      -t: Ignore k-mers that occur >= -t times in a block.\n");
+        fprintf(stderr,"      -r: Ignore k-mers that occur >= -r times in a read.\n");
         fprintf(stderr,"\n");
         fprintf(stderr,"      -e: Look for alignments with -e percent similarity.\n");
         fprintf(stderr,"      -l: Look for alignments of length >= -l.\n");
         fprintf(stderr,"      -s: Use -s as the trace point spacing for encoding alignments.\n");
         fprintf(stderr,"\n");
+        fprintf(stderr,"      -p: Scan reads with a sliding window of -p bps over the diagonals\n");
+        fprintf(stderr,"      -o:   that advances -p minus -o bps at each step.\n");
+        fprintf(stderr,"\n");
+        fprintf(stderr,"      -i: Output the tandem intervals of FASTA/FASTQ input to a BED file.\n");
+        fprintf(stderr,"      -B: Compare FASTA/FASTQ input in batches of -B Mbp.\n");
+        fprintf(stderr,"\n");
         fprintf(stderr,"      -T: Use -T threads.\n");
         fprintf(stderr,"      -P: Do first level sort and merge in directory -P.\n");
         exit (1);
       }
   }
 
-  MINOVER *= 2;
-  if (Set_Filter_Params(KMER_LEN,BIN_SHIFT,HIT_MIN,NTHREADS))
+  if (PACKED && SHARED)
+    { fprintf(stderr,"%s: -c and -S cannot be used together\n",Prog_Name);
+      exit (1);
+    }
+  if (COMPACT && BED_OUT)
+    { fprintf(stderr,"%s: -z and -i cannot be used together\n",Prog_Name);
+      exit (1);
+    }
+
+  if (BED_OUT)
+    { int   i;
+      char *r;
+
+      for (i = 1; i < argc; i++)
+        { r = Stream_Root(argv[i]);
+          if (r == NULL)
+            { fprintf(stderr,"%s: -i only applies to FASTA/FASTQ input, %s is a DB\n",
+                             Prog_Name,argv[i]);
+              exit (1);
+            }
+          free(r);
+        }
+    }
+
+  //  With -u just remove the shared segments -S made for the given blocks
+
+  if (UNSHARE)
+    { DAZZ_DB _db, *db = &_db;
+      int     i;
+
+      for (i = 1; i < argc; i++)
+        { if (Open_DB(argv[i],db) < 0)
+            exit (1);
+          Trim_DB(db);
+          if (Unshare_All_Reads(db,0) == 0 && VERBOSE)
+            printf("Removed the shared copy of %s\n",argv[i]);
+          Close_DB(db);
+        }
+      exit (0);
+    }
+
+  if (PANEL_OVERLAP >= PANEL_SIZE)
+    { fprintf(stderr,"%s: Panel overlap (%d) must be less than panel size (%d)\n",
+                     Prog_Name,PANEL_OVERLAP,PANEL_SIZE);
+      exit (1);
+    }
+
+  MASK_LEN    = MINOVER;
+  MINOVER    *= 2;
+  BATCH_SIZE  = BATCH_MBP * 1000000ll;
+  if (Set_Filter_Params(KMER_LEN,BIN_SHIFT,MAX_REPS,MAX_RREPS,HIT_MIN,NTHREADS))
     { fprintf(stderr,"Illegal combination of filter parameters\n");
       exit (1);
     }
@@ -237,7 +878,14 @@ int main(int argc, char *argv[])
     broot = NULL;
     for (i = 1; i < argc; i++)
       { bfile = argv[i];
-        isdam = read_DB(bblock,bfile,KMER_LEN);
+        broot = Stream_Root(bfile);
+        if (broot != NULL)
+          { stream_self(bfile,broot,settings);
+            free(broot);
+            continue;
+          }
+
+        isdam = read_DB(bblock,bfile,KMER_LEN,PACKED,SHARED,NTHREADS);
         if (isdam)
           broot = Root(bfile,".dam");
         else
@@ -247,22 +895,7 @@ int main(int argc, char *argv[])
 
         Close_DB(bblock);
 
-        command = CommandBuffer(broot,SORT_PATH);
-
-#define SYSTEM_CHECK(command)                                           \
- if (VERBOSE)                                                           \
-   printf("%s\n",command);                                              \
- if (system(command) != 0)                                              \
-   { fprintf(stderr,"\n%s: Command Failed:\n%*s      %s\n",             \
-                    Prog_Name,(int) strlen(Prog_Name),"",command);      \
-     Clean_Exit(1);                                                     \
-   }
-
-        sprintf(command,"LAsort %s/%s.T%c.las",SORT_PATH,broot,BLOCK_SYMBOL);
-        SYSTEM_CHECK(command)
-
-        sprintf(command,"LAmerge TAN.%s.las %s/%s.T%c.S.las",broot,SORT_PATH,broot,BLOCK_SYMBOL);
-        SYSTEM_CHECK(command)
+        sort_and_merge(broot);
       }
   }
 
@@ -0,0 +1,1028 @@
+/*******************************************************************************************
+ *
+ *  Pile iterator for .las files (see pile.h)
+ *
+ *  Author:  agent
+ *  Date  :  October 2026
+ *
+ ********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <pthread.h>
+
+#include "pile.h"
+
+static int64 PtrSize   = sizeof(void *);
+static int64 OvlIOSize = sizeof(Overlap) - sizeof(void *);
+static int64 AreadOff  = offsetof(Overlap,aread) - sizeof(void *);
+
+  //  Decode the compact .las file input into a classic image in m->map
+
+static int decode_las(Las_Map *m, FILE *input, char *name)
+{ Las2_File *las;
+  Overlap    ovl;
+  int64      novl, top, max, need;
+  int        tspace, tbytes;
+
+  if (fseeko(input,0,SEEK_SET) < 0 || (las = Open_Las2_Reader(input)) == NULL)
+    { EPRINTF(EPLACE,"%s: Cannot read %s\n",Prog_Name,name);
+      return (1);
+    }
+  novl   = las->novl;
+  tspace = las->tspace;
+  if (tspace <= TRACE_XOVR)
+    tbytes = sizeof(uint8);
+  else
+    tbytes = sizeof(uint16);
+
+  max = 2*m->fsize + 1000;
+  m->map = (char *) Malloc(max,"Allocating .las image");
+  if (m->map == NULL)
+    goto error;
+  memcpy(m->map,&novl,sizeof(int64));
+  memcpy(m->map+sizeof(int64),&tspace,sizeof(int));
+  top = sizeof(int64) + sizeof(int);
+
+  memset(&ovl,0,sizeof(Overlap));     //  So the padding of each record is 0
+  while (Read_Overlap2(las,&ovl) == 0)
+    { need = OvlIOSize + tbytes*((int64) ovl.path.tlen);
+      if (top + need > max)
+        { max = 1.2*(top+need) + 1000;
+          m->map = (char *) Realloc(m->map,max,"Expanding .las image");
+          if (m->map == NULL)
+            goto error;
+        }
+      ovl.path.trace = m->map + (top + OvlIOSize);
+      Read_Trace2(las,&ovl,tbytes);
+      memcpy(m->map+top,((char *) &ovl) + PtrSize,OvlIOSize);
+      top += need;
+    }
+  if (las->error)
+    goto error;
+
+  Close_Las2_Reader(las);
+  m->size    = top;
+  m->decoded = 1;
+  return (0);
+
+error:
+  free(m->map);
+  Close_Las2_Reader(las);
+  EPRINTF(EPLACE,"%s: Cannot decode %s\n",Prog_Name,name);
+  return (1);
+}
+
+static int map_las(Las_Map *m, FILE *input, char *name, int64 *novl, int *tspace)
+{ struct stat info;
+  int64       magic;
+
+  if (fstat(fileno(input),&info) < 0)
+    { EPRINTF(EPLACE,"%s: Cannot stat %s\n",Prog_Name,name);
+      return (1);
+    }
+  m->size = m->fsize = info.st_size;
+  if (m->size < (int64) (sizeof(int64)+sizeof(int)))
+    { EPRINTF(EPLACE,"%s: %s is not a .las file\n",Prog_Name,name);
+      return (1);
+    }
+
+  m->decoded = 0;
+  if (pread(fileno(input),&magic,sizeof(int64),0) != sizeof(int64))
+    { EPRINTF(EPLACE,"%s: Cannot read %s\n",Prog_Name,name);
+      return (1);
+    }
+  if (magic == LAS2_MAGIC)
+    { if (decode_las(m,input,name))
+        return (1);
+    }
+  else
+    { m->map = (char *) mmap(NULL,m->size,PROT_READ,MAP_PRIVATE,fileno(input),0);
+      if (m->map == MAP_FAILED)
+        { EPRINTF(EPLACE,"%s: Cannot memory map %s\n",Prog_Name,name);
+          return (1);
+        }
+      madvise(m->map,m->size,MADV_SEQUENTIAL);
+    }
+
+  memcpy(novl,m->map,sizeof(int64));
+  memcpy(tspace,m->map+sizeof(int64),sizeof(int));
+  m->ptr   = m->map + (sizeof(int64)+sizeof(int));
+  m->index = NULL;
+  return (0);
+}
+
+static void unmap_las(Las_Map *m)
+{ if (m->decoded)
+    free(m->map);
+  else
+    munmap(m->map,m->size);
+}
+
+Las_Piles *Open_Merged_Piles(int nfile, FILE **input, char *name)
+{ Las_Piles *piles;
+  int64      novl;
+  int        i, tspace;
+
+  piles = (Las_Piles *) Malloc(sizeof(Las_Piles),"Allocating pile iterator");
+  if (piles == NULL)
+    EXIT(NULL);
+  piles->maps = (Las_Map *) Malloc(sizeof(Las_Map)*nfile,"Allocating pile iterator");
+  piles->heap = (int *) Malloc(sizeof(int)*(5*nfile+1),"Allocating pile iterator");
+  piles->omax = 1000;
+  piles->ovls = (Overlap *) Malloc(sizeof(Overlap)*piles->omax,"Allocating pile vector");
+  piles->work = NULL;
+  if (nfile > 1)
+    piles->work = (Overlap *) Malloc(sizeof(Overlap)*piles->omax,"Allocating pile vector");
+  if (piles->maps == NULL || piles->heap == NULL || piles->ovls == NULL
+                          || (nfile > 1 && piles->work == NULL))
+    goto error;
+
+  piles->novl = 0;
+  for (i = 0; i < nfile; i++)
+    { if (map_las(piles->maps+i,input[i],name,&novl,&tspace))
+        goto unmap;
+      if (i == 0)
+        piles->tspace = tspace;
+      else if (tspace != piles->tspace)
+        { EPRINTF(EPLACE,"%s: Files of %s have different trace spacings\n",Prog_Name,name);
+          i += 1;
+          goto unmap;
+        }
+      piles->novl += novl;
+    }
+  piles->nfile  = nfile;
+  piles->shared = 0;
+
+  if (piles->tspace <= TRACE_XOVR)
+    piles->tbytes = sizeof(uint8);
+  else
+    piles->tbytes = sizeof(uint16);
+
+  return (piles);
+
+unmap:
+  while (i-- > 0)
+    unmap_las(piles->maps+i);
+error:
+  free(piles->work);
+  free(piles->ovls);
+  free(piles->heap);
+  free(piles->maps);
+  free(piles);
+  EXIT(NULL);
+}
+
+Las_Piles *Open_Piles(FILE *input, char *name)
+{ return (Open_Merged_Piles(1,&input,name)); }
+
+Las_Index *Build_Las_Index(FILE *input, char *name)
+{ Las_Index *index;
+  Las_Map    m;
+  Overlap    o;
+  int64      novl, n;
+  int        tspace, tbytes, imax, a, j;
+  char      *end;
+
+  if (map_las(&m,input,name,&novl,&tspace))
+    EXIT(NULL);
+  if (tspace <= TRACE_XOVR)
+    tbytes = sizeof(uint8);
+  else
+    tbytes = sizeof(uint16);
+  end = m.map + m.size;
+
+  index = (Las_Index *) Malloc(sizeof(Las_Index),"Allocating pile index");
+  if (index == NULL)
+    goto unmap;
+  imax = 1000;
+  index->off = (int64 *) Malloc(sizeof(int64)*2*(imax+1),"Allocating pile index");
+  if (index->off == NULL)
+    goto error;
+
+  //  Record the offset and LA number of the first LA of each read from the first A-read
+  //    on, reads without LAs getting those of the next pile
+
+  n = 0;
+  j = -1;
+  index->first = 0;
+  while (m.ptr + OvlIOSize <= end)
+    { memcpy(((char *) &o) + PtrSize,m.ptr,OvlIOSize);
+      a = o.aread;
+      if (j < 0)
+        j = index->first = a;
+      else if (a < j-1)
+        { EPRINTF(EPLACE,"%s: %s is not sorted\n",Prog_Name,name);
+          goto error;
+        }
+      while (j <= a)
+        { if (j-index->first >= imax)
+            { imax = 1.2*(j-index->first) + 1000;
+              index->off = (int64 *) Realloc(index->off,sizeof(int64)*2*(imax+1),
+                                             "Expanding pile index");
+              if (index->off == NULL)
+                goto error;
+            }
+          index->off[2*(j-index->first)]   = m.ptr - m.map;
+          index->off[2*(j-index->first)+1] = n;
+          j += 1;
+        }
+      m.ptr += OvlIOSize + tbytes*((int64) o.path.tlen);
+      if (m.ptr > end)
+        { EPRINTF(EPLACE,"%s: %s is truncated\n",Prog_Name,name);
+          goto error;
+        }
+      n += 1;
+    }
+  if (j < 0)
+    j = 0;
+  if (n != novl)
+    { EPRINTF(EPLACE,"%s: %s has %lld LAs but its header says %lld\n",
+                     Prog_Name,name,n,novl);
+      goto error;
+    }
+  index->last = j;
+  index->off[2*(j-index->first)]   = m.ptr - m.map;
+  index->off[2*(j-index->first)+1] = n;
+
+  //  Split the interleaved pairs into the off and cnt vectors
+
+  { int64 *x;
+    int    k, len;
+
+    len = (j-index->first)+1;
+    x = (int64 *) Malloc(sizeof(int64)*2*len,"Allocating pile index");
+    if (x == NULL)
+      goto error;
+    for (k = 0; k < len; k++)
+      { x[k]     = index->off[2*k];
+        x[len+k] = index->off[2*k+1];
+      }
+    free(index->off);
+    index->off = x;
+    index->cnt = x + len;
+  }
+
+  index->novl = novl;
+  index->size = m.fsize;
+  unmap_las(&m);
+  return (index);
+
+error:
+  free(index->off);
+  free(index);
+unmap:
+  unmap_las(&m);
+  EXIT(NULL);
+}
+
+  //  The sidecar is novl, size, first, and last followed by the vectors off and cnt.  Its
+  //    name is built here as path may well be a Catenate result.
+
+static FILE *open_sidecar(char *path, char *mode)
+{ FILE *file;
+  char *name;
+
+  name = (char *) Malloc(strlen(path)+5,"Allocating index name");
+  if (name == NULL)
+    return (NULL);
+  sprintf(name,"%s.idx",path);
+  if (*mode == 'w')
+    file = Fopen(name,mode);
+  else
+    file = fopen(name,mode);
+  free(name);
+  return (file);
+}
+
+int Write_Las_Index(Las_Index *index, char *path)
+{ FILE *output;
+  int64 len;
+
+  output = open_sidecar(path,"w");
+  if (output == NULL)
+    EXIT(1);
+  len = (index->last-index->first)+1;
+  if (fwrite(&index->novl,sizeof(int64),1,output) != 1
+      || fwrite(&index->size,sizeof(int64),1,output) != 1
+      || fwrite(&index->first,sizeof(int),1,output) != 1
+      || fwrite(&index->last,sizeof(int),1,output) != 1
+      || fwrite(index->off,sizeof(int64),len,output) != (size_t) len
+      || fwrite(index->cnt,sizeof(int64),len,output) != (size_t) len)
+    { fclose(output);
+      EPRINTF(EPLACE,"%s: Write of %s.idx failed\n",Prog_Name,path);
+      EXIT(1);
+    }
+  if (fclose(output) != 0)
+    { EPRINTF(EPLACE,"%s: Write of %s.idx failed\n",Prog_Name,path);
+      EXIT(1);
+    }
+  return (0);
+}
+
+Las_Index *Read_Las_Index(char *path, FILE *input)
+{ Las_Index  *index;
+  FILE       *ifile;
+  struct stat info;
+  int64       novl, len;
+
+  ifile = open_sidecar(path,"r");
+  if (ifile == NULL)
+    return (NULL);
+
+  index = (Las_Index *) Malloc(sizeof(Las_Index),"Allocating pile index");
+  if (index == NULL)
+    { fclose(ifile);
+      return (NULL);
+    }
+  index->off = NULL;
+
+  if (fread(&index->novl,sizeof(int64),1,ifile) != 1
+      || fread(&index->size,sizeof(int64),1,ifile) != 1
+      || fread(&index->first,sizeof(int),1,ifile) != 1
+      || fread(&index->last,sizeof(int),1,ifile) != 1
+      || index->last < index->first)
+    goto stale;
+
+  if (fstat(fileno(input),&info) < 0 || info.st_size != index->size)
+    goto stale;
+  if (pread(fileno(input),&novl,sizeof(int64),0) != sizeof(int64))
+    goto stale;
+  if (novl == LAS2_MAGIC && pread(fileno(input),&novl,sizeof(int64),sizeof(int64))
+                              != sizeof(int64))
+    goto stale;
+  if (novl != index->novl)
+    goto stale;
+
+  len = (index->last-index->first)+1;
+  index->off = (int64 *) Malloc(sizeof(int64)*2*len,"Allocating pile index");
+  if (index->off == NULL)
+    { free(index);
+      fclose(ifile);
+      return (NULL);
+    }
+  index->cnt = index->off + len;
+  if (fread(index->off,sizeof(int64),2*len,ifile) != (size_t) (2*len))
+    goto stale;
+
+  fclose(ifile);
+  return (index);
+
+stale:
+  fprintf(stderr,"%s: Warning: index %s.idx does not match its .las file, ignored\n",
+                 Prog_Name,path);
+  free(index->off);
+  free(index);
+  fclose(ifile);
+  return (NULL);
+}
+
+void Free_Las_Index(Las_Index *index)
+{ if (index == NULL)
+    return;
+  free(index->off);
+  free(index);
+}
+
+static int peek_map(Las_Map *m)
+{ int aread;
+
+  if (m->ptr + OvlIOSize > m->map + m->size)
+    return (INT32_MAX);
+  memcpy(&aread,m->ptr+AreadOff,sizeof(int));
+  return (aread);
+}
+
+int Peek_Pile(Las_Piles *piles)
+{ int i, a, min;
+
+  min = INT32_MAX;
+  for (i = 0; i < piles->nfile; i++)
+    { a = peek_map(piles->maps+i);
+      if (a < min)
+        min = a;
+    }
+  return (min);
+}
+
+  //  Make room for at least n+1 records in ovls (and work if merging), returning 1 on failure
+
+static int pile_room(Las_Piles *piles, int n)
+{ Overlap *ovls, *work;
+  int      omax;
+
+  if (n < piles->omax)
+    return (0);
+  omax = 1.2*n + 1000;
+  ovls = (Overlap *) Realloc(piles->ovls,sizeof(Overlap)*omax,"Expanding pile vector");
+  if (ovls == NULL)
+    EXIT(1);
+  piles->ovls = ovls;
+  if (piles->nfile > 1)
+    { work = (Overlap *) Realloc(piles->work,sizeof(Overlap)*omax,"Expanding pile vector");
+      if (work == NULL)
+        EXIT(1);
+      piles->work = work;
+    }
+  piles->omax = omax;
+  return (0);
+}
+
+  //  Append the pile of m (if its next LA is for aread) to ovls[n..], stopping early if the
+  //    vector reaches lim records, and return the new size, or -1 if an error occurred
+
+static int read_pile(Las_Piles *piles, Las_Map *m, int aread, int n, int lim)
+{ char    *end = m->map + m->size;
+  Overlap *o;
+
+  while (n < lim && m->ptr + OvlIOSize <= end)
+    { if (pile_room(piles,n))
+        EXIT(-1);
+      o = piles->ovls + n;
+      memcpy(((char *) o) + PtrSize,m->ptr,OvlIOSize);
+      if (o->aread != aread)
+        break;
+      o->path.trace = (void *) (m->ptr + OvlIOSize);
+      m->ptr += OvlIOSize + piles->tbytes*((int64) o->path.tlen);
+      if (m->ptr > end)
+        { EPRINTF(EPLACE,"%s: .las file is truncated\n",Prog_Name);
+          EXIT(-1);
+        }
+      n += 1;
+    }
+  return (n);
+}
+
+  //  LAs of a pile are in the order of LAsort and LAmerge: by B-read, orientation, and then
+  //    A-start.  Ties are broken by file order so the merge is deterministic.
+
+static int ovl_less(Overlap *x, int fx, Overlap *y, int fy)
+{ if (x->bread != y->bread)
+    return (x->bread < y->bread);
+  if (COMP(x->flags) != COMP(y->flags))
+    return (COMP(x->flags) < COMP(y->flags));
+  if (x->path.abpos != y->path.abpos)
+    return (x->path.abpos < y->path.abpos);
+  return (fx < fy);
+}
+
+  //  Read the next pile into ovls and return its size, unless it has more than cap LAs
+  //    (cap > 0) in which case the maps are left as they were and GIANT_PILE is returned.
+  //    -1 is returned if an error occurred.
+
+#define GIANT_PILE  -2
+
+static int next_pile(Las_Piles *piles, int cap)
+{ Las_Map *maps = piles->maps;
+  int      nfile = piles->nfile;
+  int     *heap  = piles->heap;
+  int      i, n, aread, nrun, lim;
+
+  aread = Peek_Pile(piles);
+  if (aread == INT32_MAX)
+    return (0);
+  if (cap > 0)
+    lim = cap+1;
+  else
+    lim = INT32_MAX;
+  if (nfile == 1)
+    { char *ptr = maps->ptr;
+
+      n = read_pile(piles,maps,aread,0,lim);
+      if (n >= lim)
+        { maps->ptr = ptr;
+          return (GIANT_PILE);
+        }
+      return (n);
+    }
+
+  //  Read the pile of each file that has one for aread into ovls, recording the start of
+  //    each run and its file in the heap vector's spare room, then heap merge the runs
+  //    into work and swap work and ovls.
+
+  { int  *beg, *cur, *end, *fil;
+    int   k, c, x, h;
+
+    beg = heap + (nfile+1);
+    cur = beg + nfile;
+    end = cur + nfile;
+    fil = end + nfile;
+
+    n    = 0;
+    nrun = 0;
+    for (i = 0; i < nfile; i++)
+      if (peek_map(maps+i) == aread)
+        { beg[nrun] = n;
+          n = read_pile(piles,maps+i,aread,n,lim);
+          if (n < 0)
+            return (-1);
+          end[nrun] = n;
+          fil[nrun] = i;
+          nrun += 1;
+          if (n >= lim)
+            break;
+        }
+    if (n >= lim)
+      { for (k = 0; k < nrun; k++)
+          maps[fil[k]].ptr = ((char *) piles->ovls[beg[k]].path.trace) - OvlIOSize;
+        return (GIANT_PILE);
+      }
+    if (nrun == 1)
+      return (n);
+
+    //  heap[1..h] holds the runs with LAs left, heap[1] the run with the least next LA
+
+#define LESS(r,s) ovl_less(ovls+cur[r],fil[r],ovls+cur[s],fil[s])
+
+    { Overlap *ovls = piles->ovls;
+      Overlap *work = piles->work;
+
+      for (k = 0; k < nrun; k++)
+        cur[k] = beg[k];
+
+      h = 0;
+      for (k = 0; k < nrun; k++)
+        { c = ++h;
+          while (c > 1 && LESS(k,heap[c/2]))
+            { heap[c] = heap[c/2];
+              c /= 2;
+            }
+          heap[c] = k;
+        }
+
+      for (i = 0; i < n; i++)
+        { k = heap[1];
+          work[i] = ovls[cur[k]++];
+          if (cur[k] >= end[k])
+            k = heap[h--];
+          c = 1;
+          while ((x = 2*c) <= h)
+            { if (x < h && LESS(heap[x+1],heap[x]))
+                x += 1;
+              if ( ! LESS(heap[x],k))
+                break;
+              heap[c] = heap[x];
+              c = x;
+            }
+          heap[c] = k;
+        }
+
+      piles->ovls = work;
+      piles->work = ovls;
+    }
+  }
+
+  return (n);
+}
+
+int Next_Pile(Las_Piles *piles)
+{ return (next_pile(piles,0)); }
+
+int Next_Pile_Part(Las_Piles *piles, int aread, int max)
+{ Las_Map *maps = piles->maps;
+  int      nfile = piles->nfile;
+  Overlap *o, x;
+  int      i, n, b, m;
+
+  if (nfile == 1)
+    { if (peek_map(maps) != aread)
+        return (0);
+      return (read_pile(piles,maps,aread,0,max));
+    }
+
+  //  Take the least next LA over the files one at a time (this path is only for the rare
+  //    piles too large to hold, so the linear scan over the files is immaterial)
+
+  for (n = 0; n < max; n++)
+    { if (pile_room(piles,n))
+        EXIT(-1);
+      o = piles->ovls + n;
+      b = -1;
+      for (i = 0; i < nfile; i++)
+        if (peek_map(maps+i) == aread)
+          { memcpy(((char *) &x) + PtrSize,maps[i].ptr,OvlIOSize);
+            if (b < 0 || ovl_less(&x,i,o,b))
+              { *o = x;
+                b  = i;
+              }
+          }
+      if (b < 0)
+        break;
+      m = read_pile(piles,maps+b,aread,n,n+1);
+      if (m < 0)
+        return (-1);
+      if (m != n+1)
+        break;
+    }
+  return (n);
+}
+
+Las_Piles *Dup_Piles(Las_Piles *piles)
+{ Las_Piles *dup;
+  int        nfile = piles->nfile;
+
+  dup = (Las_Piles *) Malloc(sizeof(Las_Piles),"Allocating pile iterator");
+  if (dup == NULL)
+    EXIT(NULL);
+  *dup = *piles;
+  dup->maps = (Las_Map *) Malloc(sizeof(Las_Map)*nfile,"Allocating pile iterator");
+  dup->heap = (int *) Malloc(sizeof(int)*(5*nfile+1),"Allocating pile iterator");
+  dup->omax = 1000;
+  dup->ovls = (Overlap *) Malloc(sizeof(Overlap)*dup->omax,"Allocating pile vector");
+  dup->work = NULL;
+  if (nfile > 1)
+    dup->work = (Overlap *) Malloc(sizeof(Overlap)*dup->omax,"Allocating pile vector");
+  if (dup->maps == NULL || dup->heap == NULL || dup->ovls == NULL
+                        || (nfile > 1 && dup->work == NULL))
+    { free(dup->work);
+      free(dup->ovls);
+      free(dup->heap);
+      free(dup->maps);
+      free(dup);
+      EXIT(NULL);
+    }
+  memcpy(dup->maps,piles->maps,sizeof(Las_Map)*nfile);
+  dup->shared = 1;
+  return (dup);
+}
+
+void Index_Piles(Las_Piles *piles, int i, Las_Index *index)
+{ piles->maps[i].index = index; }
+
+int Piles_Indexed(Las_Piles *piles)
+{ int i;
+
+  for (i = 0; i < piles->nfile; i++)
+    if (piles->maps[i].index == NULL)
+      return (0);
+  return (1);
+}
+
+int64 Pile_Size(Las_Piles *piles, int aread)
+{ Las_Index *x;
+  int64      n;
+  int        i, a;
+
+  n = 0;
+  for (i = 0; i < piles->nfile; i++)
+    { x = piles->maps[i].index;
+      if (aread >= x->first && aread < x->last)
+        { a  = aread - x->first;
+          n += x->cnt[a+1] - x->cnt[a];
+        }
+    }
+  return (n);
+}
+
+void Seek_Piles(Las_Piles *piles, int aread)
+{ Las_Map   *m;
+  Las_Index *x;
+  Overlap    o;
+  int        i, a;
+
+  for (i = 0; i < piles->nfile; i++)
+    { m = piles->maps + i;
+      x = m->index;
+      if (x != NULL)
+        { if (aread <= x->first)
+            a = 0;
+          else if (aread >= x->last)
+            a = x->last - x->first;
+          else
+            a = aread - x->first;
+          m->ptr = m->map + x->off[a];
+        }
+      else
+        { m->ptr = m->map + (sizeof(int64)+sizeof(int));
+          while (peek_map(m) < aread)
+            { memcpy(((char *) &o) + PtrSize,m->ptr,OvlIOSize);
+              m->ptr += OvlIOSize + piles->tbytes*((int64) o.path.tlen);
+            }
+        }
+    }
+}
+
+int Pile_Range(Las_Piles *piles, int *first, int *last)
+{ Las_Index *x;
+  int        i;
+
+  *first = INT32_MAX;
+  *last  = 0;
+  for (i = 0; i < piles->nfile; i++)
+    { x = piles->maps[i].index;
+      if (x == NULL)
+        return (0);
+      if (x->novl == 0)
+        continue;
+      if (x->first < *first)
+        *first = x->first;
+      if (x->last > *last)
+        *last = x->last;
+    }
+  return (*first < *last);
+}
+
+void Close_Piles(Las_Piles *piles)
+{ int i;
+
+  if ( ! piles->shared)
+    for (i = 0; i < piles->nfile; i++)
+      unmap_las(piles->maps+i);
+  free(piles->maps);
+  free(piles->heap);
+  free(piles->work);
+  free(piles->ovls);
+  free(piles);
+}
+
+int Read_Pile_Batch(Las_Piles *piles, Pile_Batch *batch, int rbeg, int rlast, int64 nmin,
+                    int cap)
+{ int64 n;
+  int   j, a, m;
+
+  batch->rbeg  = rbeg;
+  batch->giant = 0;
+  n = 0;
+  for (j = rbeg; j < rlast; j++)
+    { if (j-rbeg >= batch->pmax)
+        { int    pmax = 1.2*(j-rbeg) + 1000;
+          int64 *pile;
+
+          pile = (int64 *) Realloc(batch->pile,sizeof(int64)*(pmax+1),"Expanding pile index");
+          if (pile == NULL)
+            EXIT(-1);
+          batch->pile = pile;
+          batch->pmax = pmax;
+        }
+      batch->pile[j-rbeg] = n;
+      if (n >= nmin)
+        break;
+
+      a = Peek_Pile(piles);
+      if (a < j)
+        return (1);
+      if (a == j)
+        { m = next_pile(piles,cap);
+          if (m == GIANT_PILE)
+            { batch->giant = 1;
+              break;
+            }
+          if (m < 0)
+            return (-1);
+          if (n + m > batch->omax)
+            { int64    omax = 1.2*(n+m) + 10000;
+              Overlap *ovls;
+
+              ovls = (Overlap *) Realloc(batch->ovls,sizeof(Overlap)*omax,
+                                         "Expanding overlap buffer");
+              if (ovls == NULL)
+                EXIT(-1);
+              batch->ovls = ovls;
+              batch->omax = omax;
+            }
+          memcpy(batch->ovls+n,piles->ovls,sizeof(Overlap)*m);
+          n += m;
+        }
+    }
+  batch->rend = j;
+  batch->pile[j-rbeg] = n;
+  return (0);
+}
+
+void Free_Pile_Batch(Pile_Batch *batch)
+{ free(batch->ovls);
+  free(batch->pile);
+  batch->ovls = NULL;
+  batch->pile = NULL;
+  batch->omax = 0;
+  batch->pmax = 0;
+}
+
+
+  //  The part [rbeg,rend) of a batch given to a thread, which with an index reads it itself
+  //    into its own batch with its own iterator piles
+
+typedef struct
+  { Pile_Pass  *pass;
+    void       *arg;
+    Las_Piles  *piles;
+    Pile_Batch *batch;
+    Pile_Batch  own;
+    int         rbeg, rend;
+    int         error;
+  } Pass_Arg;
+
+static void *pass_thread(void *arg)
+{ Pass_Arg   *parm  = (Pass_Arg *) arg;
+  Pile_Pass  *pass  = parm->pass;
+  Pile_Batch *batch = parm->batch;
+  int64      *pile;
+  int         j;
+
+  if (parm->piles != NULL && parm->rbeg < parm->rend)
+    { Seek_Piles(parm->piles,parm->rbeg);
+      parm->error = Read_Pile_Batch(parm->piles,batch,parm->rbeg,parm->rend,INT64_MAX,0);
+      if (parm->error)
+        return (NULL);
+    }
+
+  pile = batch->pile - batch->rbeg;
+  pass->start(parm->arg,parm->rbeg,parm->rend);
+  for (j = parm->rbeg; j < parm->rend; j++)
+    pass->pile(parm->arg,j,batch->ovls+pile[j],(int) (pile[j+1]-pile[j]));
+  return (NULL);
+}
+
+static void pass_giant(Las_Piles *piles, Pile_Pass *pass, int aread)
+{ void *arg = pass->arg[pass->nthreads];
+
+  pass->start(arg,aread,aread+1);
+  pass->giant(arg,aread,piles);
+}
+
+static void pass_finish(Pile_Pass *pass, int giant)
+{ int i;
+
+  for (i = 0; i < pass->nthreads; i++)
+    pass->finish(pass->arg[i]);
+  if (giant)
+    pass->finish(pass->arg[pass->nthreads]);
+}
+
+  //  When the .las files are indexed the size of every pile is known without reading them,
+  //    so each batch is planned and divided among the threads up front, and each thread then
+  //    reads its part of the batch itself with its own copy of the iterator.
+
+static int indexed_pass(Las_Piles *piles, int first, int last, Pile_Pass *pass, Pass_Arg *parm)
+{ int       nthreads = pass->nthreads;
+  pthread_t threads[nthreads];
+  int       i, j, rbeg, rend, giant, error;
+  int64     n, m, s;
+
+  error = 0;
+  for (i = 0; i < nthreads; i++)
+    { parm[i].piles = Dup_Piles(piles);
+      if (parm[i].piles == NULL)
+        { while (i-- > 0)
+            Close_Piles(parm[i].piles);
+          return (-1);
+        }
+      parm[i].batch = &(parm[i].own);
+    }
+
+  for (rbeg = first; rbeg < last && ! error; rbeg = rend + giant)
+    { n     = 0;
+      giant = 0;
+      for (rend = rbeg; rend < last && n < pass->nmin; rend++)
+        { m = Pile_Size(piles,rend);
+          if (m > pass->cap)
+            { giant = 1;
+              break;
+            }
+          n += m;
+        }
+
+      j = rbeg;
+      s = 0;
+      for (i = 0; i < nthreads; i++)
+        { parm[i].rbeg = j;
+          while (j < rend && s < (n*(i+1))/nthreads)
+            s += Pile_Size(piles,j++);
+          if (i == nthreads-1)
+            j = rend;
+          parm[i].rend = j;
+        }
+
+      for (i = 0; i < nthreads; i++)
+        pthread_create(threads+i,NULL,pass_thread,parm+i);
+
+      if (giant)
+        { Seek_Piles(piles,rend);
+          pass_giant(piles,pass,rend);
+        }
+
+      for (i = 0; i < nthreads; i++)
+        { pthread_join(threads[i],NULL);
+          if (error == 0 || parm[i].error < 0)
+            error = parm[i].error;
+        }
+
+      if ( ! error)
+        pass_finish(pass,giant);
+    }
+
+  for (i = 0; i < nthreads; i++)
+    { Close_Piles(parm[i].piles);
+      Free_Pile_Batch(&(parm[i].own));
+    }
+  return (error);
+}
+
+  //  Otherwise each successive batch is worked on by the threads while the main thread reads
+  //    the next batch (after streaming a giant pile that ended the batch).
+
+int Pass_Piles(Las_Piles *piles, int first, int last, Pile_Pass *pass)
+{ int         nthreads = pass->nthreads;
+  pthread_t   threads[nthreads];
+  Pass_Arg    parm[nthreads];
+  Pile_Batch  batches[2];
+  Pile_Batch *cur, *nxt;
+  int         i, j, giant, next, error;
+
+  //  If every file is indexed, files that are not for [first,last) are rejected up front
+
+  if (Pile_Range(piles,&i,&j) && (i < first || j > last))
+    return (1);
+
+  memset(parm,0,sizeof(Pass_Arg)*nthreads);
+  for (i = 0; i < nthreads; i++)
+    { parm[i].pass = pass;
+      parm[i].arg  = pass->arg[i];
+    }
+
+  if (Piles_Indexed(piles))
+    return (indexed_pass(piles,first,last,pass,parm));
+
+  memset(batches,0,sizeof(batches));
+  cur = batches;
+  nxt = batches+1;
+  error = Read_Pile_Batch(piles,cur,first,last,pass->nmin,pass->cap);
+  if (error)
+    goto done;
+  while (1)
+    { int64 *pile = cur->pile;
+      int64  n    = pile[cur->rend-cur->rbeg];
+
+      j = cur->rbeg;
+      for (i = 0; i < nthreads; i++)
+        { parm[i].batch = cur;
+          parm[i].rbeg  = j;
+          while (j < cur->rend && pile[j-cur->rbeg] < (n*(i+1))/nthreads)
+            j += 1;
+          if (i == nthreads-1)
+            j = cur->rend;
+          parm[i].rend = j;
+        }
+
+      for (i = 0; i < nthreads; i++)
+        pthread_create(threads+i,NULL,pass_thread,parm+i);
+
+      giant = cur->giant;
+      if (giant)
+        pass_giant(piles,pass,cur->rend);
+
+      next = cur->rend + giant;
+      if (next < last)
+        error = Read_Pile_Batch(piles,nxt,next,last,pass->nmin,pass->cap);
+
+      for (i = 0; i < nthreads; i++)
+        pthread_join(threads[i],NULL);
+
+      if (error)
+        goto done;
+
+      pass_finish(pass,giant);
+
+      if (next >= last)
+        break;
+
+      cur = nxt;
+      nxt = batches + (cur == batches);
+    }
+
+  error = (Peek_Pile(piles) != INT32_MAX);
+
+  //  A file that ends part way through an LA record is truncated
+
+  if (error == 0)
+    for (i = 0; i < piles->nfile; i++)
+      if (piles->maps[i].ptr != piles->maps[i].map + piles->maps[i].size)
+        { EPRINTF(EPLACE,"%s: .las file is truncated\n",Prog_Name);
+          error = -1;
+          break;
+        }
+
+done:
+  Free_Pile_Batch(batches);
+  Free_Pile_Batch(batches+1);
+  return (error);
+}
+
+Las_Index *Block_Las_Index(Block_Looper *parse, FILE *input)
+{ Las_Index *index;
+  char      *path, *name;
+
+  path  = Block_Arg_Path(parse);
+  name  = Block_Arg_Root(parse);
+  index = Read_Las_Index(Catenate(path,"/",name,".las"),input);
+  free(path);
+  free(name);
+  return (index);
+}
@@ -0,0 +1,187 @@
+/*******************************************************************************************
+ *
+ *  Pile iterator for .las files.  The file is memory mapped and the LAs of each successive
+ *    A-read (a pile) are presented in a reusable vector of Overlap records whose trace
+ *    pointers point directly at the trace bytes in the mapped file (tbytes bytes per value,
+ *    i.e. not decompressed if tbytes = 1).  Several sorted .las files, e.g. the unmerged
+ *    block-pair files of an A-block, can be iterated as one, their piles being merged on the
+ *    fly in the order of LAmerge.  A compact (version 2) .las file (see align.h) is instead
+ *    decoded into a classic image in memory when opened, and is otherwise treated the same.
+ *
+ *  Author:  agent
+ *  Date  :  October 2026
+ *
+ ********************************************************************************************/
+
+#ifndef _PILE
+
+#define _PILE
+
+#include "DB.h"
+#include "align.h"
+
+  //  A pile index for a sorted .las file whose LAs are for reads [first,last): the pile of
+  //    read j starts at byte off[j-first] of the file (of its classic image if compact) and
+  //    is LAs cnt[j-first] through cnt[j+1-first]-1.  It is kept in the sidecar file
+  //    <las>.idx, and size and novl are those of the .las file indexed so that a stale index
+  //    can be recognized.
+
+typedef struct
+  { int64    novl;
+    int64    size;
+    int      first, last;
+    int64   *off;      //  off[0..last-first] and cnt[0..last-first]
+    int64   *cnt;
+  } Las_Index;
+
+  //  Build the index of the open .las file input (name is used for error messages only).
+  //    As in DB.c, an error is reported to EPLACE and the routine exits, or if INTERACTIVE is
+  //    defined returns the error value given in its description (here NULL).
+
+Las_Index *Build_Las_Index(FILE *input, char *name);
+
+  //  Write index to the sidecar of the .las file at path, returning 1 on an error.
+
+int Write_Las_Index(Las_Index *index, char *path);
+
+  //  Read the sidecar index of the .las file at path that is open as input.  Returns NULL if
+  //    there is no index or if it does not match the file (a warning is then printed).
+
+Las_Index *Read_Las_Index(char *path, FILE *input);
+
+void Free_Las_Index(Las_Index *index);
+
+typedef struct
+  { char      *map;    //  A mapped file, map[0..size)
+    int64      size;
+    int64      fsize;  //  Size of the file
+    int        decoded; //  map is the decoded classic image of a compact file
+    char      *ptr;    //  Next unread LA record in the map
+    Las_Index *index;  //  Pile index of the file (or NULL if none)
+  } Las_Map;
+
+typedef struct
+  { int64    novl;     //  # of LAs in the file(s) (from the headers)
+    int      tspace;   //  Trace spacing
+    int      tbytes;   //  Bytes per trace value
+    int      nfile;    //  The mapped files, maps[0..nfile)
+    Las_Map *maps;
+    int      omax;     //  Current pile is ovls[0..npile), ovls has room for omax records
+    Overlap *ovls;
+    Overlap *work;     //  Merge work vectors (if nfile > 1), work has room for omax records
+    int     *heap;     //    and heap[0..nfile] followed by 4 run vectors of nfile ints
+    int      shared;   //  The maps belong to the iterator this one is a copy of
+  } Las_Piles;
+
+  //  Map the open .las file input (name is used for error messages only), returning NULL on
+  //    an error.
+
+Las_Piles *Open_Piles(FILE *input, char *name);
+
+  //  Map the nfile open and sorted .las files input[0..nfile) and iterate over them as one,
+  //    returning NULL on an error.
+
+Las_Piles *Open_Merged_Piles(int nfile, FILE **input, char *name);
+
+  //  Return the A-read of the next pile, or INT32_MAX if there are no more LAs.
+
+int Peek_Pile(Las_Piles *piles);
+
+  //  Read the next pile into piles->ovls and return its size (0 if at the end of the file,
+  //    -1 on an error).  The records are valid until the next call.
+
+int Next_Pile(Las_Piles *piles);
+
+  //  Read the next at most max LAs of the pile of aread, in pile order, into piles->ovls and
+  //    return how many were read (0 once the pile is exhausted, -1 on an error).  Lets a pile
+  //    too large to hold be streamed in parts.
+
+int Next_Pile_Part(Las_Piles *piles, int aread, int max);
+
+  //  Another iterator over the same maps (and indices) as piles, with its own position and
+  //    pile vectors, so that threads can read different parts of the files at once.  It
+  //    must be closed before piles.  Returns NULL on an error.
+
+Las_Piles *Dup_Piles(Las_Piles *piles);
+
+  //  Use index (which remains the caller's to free) for the i'th file of piles.
+
+void Index_Piles(Las_Piles *piles, int i, Las_Index *index);
+
+  //  Return 1 if every file of piles has an index, and 0 otherwise.
+
+int Piles_Indexed(Las_Piles *piles);
+
+  //  The number of LAs in the pile of aread over all the files (every file must be indexed).
+
+int64 Pile_Size(Las_Piles *piles, int aread);
+
+  //  Position the iterator at the pile of the first read >= aread.  This takes O(1) time for
+  //    each file with an index and a scan from the start of the file for the others.
+
+void Seek_Piles(Las_Piles *piles, int aread);
+
+  //  If every file has an index and there are LAs, then set [*first,*last) to the range of
+  //    reads that have LAs in the files and return 1, otherwise return 0.
+
+int Pile_Range(Las_Piles *piles, int *first, int *last);
+
+void Close_Piles(Las_Piles *piles);
+
+  //  A batch of consecutive piles for reads [rbeg,rend) (some may be empty): the pile of read j
+  //    is ovls[pile[j-rbeg],pile[j+1-rbeg]).
+
+typedef struct
+  { int      rbeg, rend;
+    int64    omax;
+    Overlap *ovls;
+    int      pmax;
+    int64   *pile;
+    int      giant;    //  The pile of read rend was not read as it has more than cap LAs
+  } Pile_Batch;
+
+  //  Read the piles of reads rbeg, rbeg+1, ... into batch until it holds at least nmin LAs or
+  //    read rlast is reached (a pile is never split).  Returns 1 if an LA is encountered whose
+  //    A-read precedes the read being gathered (i.e. the file is not sorted or not for the
+  //    given range of reads), -1 on an error, and 0 otherwise.  If cap > 0 then the batch also ends at the
+  //    first pile with more than cap LAs, which is left unread and flagged with batch->giant
+  //    so the caller can take it with Next_Pile_Part.
+
+int Read_Pile_Batch(Las_Piles *piles, Pile_Batch *batch, int rbeg, int rlast, int64 nmin,
+                    int cap);
+
+void Free_Pile_Batch(Pile_Batch *batch);
+
+  //  A pass over the piles with nthreads threads, each with its own argument arg[i], and the
+  //    main thread with arg[nthreads].  The piles are taken in batches of at least nmin LAs
+  //    that are divided among the threads, and a thread calls start on the reads [rbeg,rend)
+  //    of its part of a batch and then pile on each of them in order.  A pile of more than
+  //    cap LAs is not held but handed to giant with piles positioned at it (after start on
+  //    [aread,aread+1)), in the main thread while the threads work on the batch before it.
+  //    When a batch is done finish is called on arg[0..nthreads), and then on arg[nthreads]
+  //    if there was a giant pile, so that the results can be output in read order.
+
+typedef struct
+  { int     nthreads;
+    void  **arg;
+    int64   nmin;
+    int     cap;
+    void  (*start)(void *arg, int rbeg, int rend);
+    void  (*pile)(void *arg, int aread, Overlap *ovls, int novl);
+    void  (*giant)(void *arg, int aread, Las_Piles *piles);
+    void  (*finish)(void *arg);
+  } Pile_Pass;
+
+  //  Make a pass over the piles of reads [first,last).  If every file of piles is indexed then
+  //    each batch is planned from the index and each thread reads its own part, and otherwise
+  //    the main thread reads the next batch while the threads work on the current one.
+  //    Returns 1 if the LAs are not sorted or not all for reads [first,last), -1 on an error,
+  //    and 0 otherwise.
+
+int Pass_Piles(Las_Piles *piles, int first, int last, Pile_Pass *pass);
+
+  //  The sidecar index of the current .las file of parse open as input (see Read_Las_Index)
+
+Las_Index *Block_Las_Index(Block_Looper *parse, FILE *input);
+
+#endif
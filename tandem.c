@@ -26,9 +26,6 @@
 
 #define THREAD    pthread_t
 
-#define PANEL_SIZE     50000   //  Size to break up very long A-reads
-#define PANEL_OVERLAP  10000   //  Overlap of A-panels
-
 #define MATCH_CHUNK    100     //  Max initial number of hits between two reads
 #define TRACE_CHUNK  20000     //  Max initial trace points in hits between two reads
 
@@ -90,6 +87,8 @@ typedef struct
 static int Kmer;
 static int Hitmin;
 static int Binshift;
+static int Blockmax;    //  Ignore K-mers occuring >= Blockmax times in the block (if > 0)
+static int Readmax;     //  Ignore K-mers occuring >= Readmax times in a read (if > 0)
 
 static int    Kshift;         //  2*Kmer
 static uint64 Kmask;          //  4^Kmer-1
@@ -97,12 +96,14 @@ static uint64 Kmask;          //  4^Kmer-1
 static int NTHREADS;    //  Must be a power of 2
 static int NSHIFT;      //  log_2 NTHREADS
 
-int Set_Filter_Params(int kmer, int binshift, int hitmin, int nthreads)
+int Set_Filter_Params(int kmer, int binshift, int suppress, int rsuppress, int hitmin, int nthreads)
 { if (kmer <= 1)
     return (1);
 
   Kmer     = kmer;
   Binshift = binshift;
+  Blockmax = suppress;
+  Readmax  = rsuppress;
   Hitmin   = hitmin;
 
   Kshift = 2*Kmer;
@@ -349,40 +350,99 @@ static Double *lex_sort(int bytes[16], Double *src, Double *trg, Lex_Arg *parmx)
 
 static DAZZ_DB    *TA_block;
 static KmerPos    *TA_list;
+static int        *TA_kbeg;    //  TA_kbeg[i] = index in TA_list of the first k-mer of read i
 
 typedef struct
   { int    tnum;
     int64 *kptr;
   } Tuple_Arg;
 
+  //  If the block is packed then the k-mers are taken directly from the 2-bit compressed
+  //    reads, 4 at a time for each byte shifted into the code (so long as Kmer <= 29 and the
+  //    4 codes fit in a 64-bit word), and one base at a time otherwise.
+
+#define EMIT_KMER(v,q)		\
+  { list[n].read = i;		\
+    list[n].rpos = q;		\
+    list[n].code = v;		\
+    n += 1;			\
+    kptr[v & BMASK] += 1;	\
+  }
+
 static void *tuple_thread(void *arg)
 { Tuple_Arg  *data  = (Tuple_Arg *) arg;
   int         tnum  = data->tnum;
   int64      *kptr  = data->kptr;
   KmerPos    *list  = TA_list;
+  DAZZ_READ  *reads = TA_block->reads;
   int         i, m, n, x, p;
-  uint64      c;
-  char       *s;
-
-  c  = TA_block->nreads;
-  i  = (c * tnum) >> NSHIFT;
-  n  = TA_block->reads[i].boff;
-  s  = ((char *) (TA_block->bases)) + n;
-  n -= Kmer*i;
-
-  for (m = (c * (tnum+1)) >> NSHIFT; i < m; i++)
-    { c = p = 0;
-      for (x = 1; x < Kmer; x++)
-        c = (c << 2) | s[p++];
-      while ((x = s[p]) != 4)
-        { c = ((c << 2) | x) & Kmask;
-          list[n].read = i;
-          list[n].rpos = ++p;
-          list[n].code = c;
-          n += 1;
-          kptr[c & BMASK] += 1;
+  int         len;
+  uint64      c, d;
+
+  c = TA_block->nreads;
+  i = (c * tnum) >> NSHIFT;
+  m = (c * (tnum+1)) >> NSHIFT;
+
+  if (TA_block->loaded == DB_MAPPED)
+    { uint8 *s;
+      int    e;
+
+      for ( ; i < m; i++)
+        { len = reads[i].rlen;
+          if (len < Kmer)
+            continue;
+          s = ((uint8 *) (TA_block->bases)) + reads[i].boff;
+          n = TA_kbeg[i];
+
+          c = 0;
+          for (p = 0; p < len; p++)
+            { if (p >= Kmer-1 && (p & 0x3) == 0 && Kmer <= 29)
+                break;
+              c = (c << 2) | ((s[p>>2] >> (6-2*(p&0x3))) & 0x3);
+              if (p >= Kmer-1)
+                { d = c & Kmask;
+                  EMIT_KMER(d,p+1)
+                }
+            }
+          e = (len & ~0x3);
+          for ( ; p < e; p += 4)
+            { c = (c << 8) | s[p>>2];
+              d = (c >> 6) & Kmask;
+              EMIT_KMER(d,p+1)
+              d = (c >> 4) & Kmask;
+              EMIT_KMER(d,p+2)
+              d = (c >> 2) & Kmask;
+              EMIT_KMER(d,p+3)
+              d = c & Kmask;
+              EMIT_KMER(d,p+4)
+            }
+          for ( ; p < len; p++)
+            { c = (c << 2) | ((s[p>>2] >> (6-2*(p&0x3))) & 0x3);
+              d = c & Kmask;
+              EMIT_KMER(d,p+1)
+            }
+        }
+    }
+
+  else
+    { char *s;
+
+      for ( ; i < m; i++)
+        { len = reads[i].rlen;
+          if (len < Kmer)
+            continue;
+          s = ((char *) (TA_block->bases)) + reads[i].boff;
+          n = TA_kbeg[i];
+
+          c = p = 0;
+          for (x = 1; x < Kmer; x++)
+            c = (c << 2) | s[p++];
+          while ((x = s[p]) != 4)
+            { c = ((c << 2) | x) & Kmask;
+              p += 1;
+              EMIT_KMER(c,p)
+            }
         }
-      s += (p+1);
     }
 
   return (NULL);
@@ -407,7 +467,18 @@ static KmerPos *Sort_Kmers(DAZZ_DB *block, int *len, KmerPos **buffer)
     mersort[i>>3] = 1;
 
   nreads = block->nreads;
-  kmers  = block->reads[nreads].boff - Kmer * nreads;
+
+  TA_kbeg = (int *) Malloc(sizeof(int)*(nreads+1),"Allocating Sort_Kmers vectors");
+  if (TA_kbeg == NULL)
+    Clean_Exit(1);
+
+  kmers = 0;
+  for (i = 0; i < nreads; i++)
+    { TA_kbeg[i] = kmers;
+      if (block->reads[i].rlen >= Kmer)
+        kmers += block->reads[i].rlen - (Kmer-1);
+    }
+  TA_kbeg[nreads] = kmers;
 
   if (kmers <= 0)
     goto no_mers;
@@ -450,7 +521,7 @@ static KmerPos *Sort_Kmers(DAZZ_DB *block, int *len, KmerPos **buffer)
   for (i = 0; i < NTHREADS; i++)
     { parmx[i].beg = x;
       j = (int) ((((int64) nreads) * (i+1)) >> NSHIFT);
-      parmx[i].end = x = block->reads[j].boff - j*Kmer;
+      parmx[i].end = x = TA_kbeg[j];
     }
 
   rez = (KmerPos *) lex_sort(mersort,(Double *) src,(Double *) trg,parmx);
@@ -509,45 +580,82 @@ no_mers:
   //   stably resorted on read,rpos so that for each read one has effectively a "linked list" of
   //   positions with equal K-mers.
 
+  //  A K-mer occurring Blockmax or more times in the block, or Readmax or more times in a given
+  //   read, is not linked (if the respective cap is non-zero), so that low-complexity and
+  //   high-copy sequence does not flood the diagonal filter.
+
+  //  In passing, each link is also tallied in a small per-read histogram of its diagonal band
+  //    (DIAG_BINS counters per read) so that the report phase can skip reads for which no pair
+  //    of adjacent diagonals can possibly reach Hitmin.  Each thread counts into its own set of
+  //    histograms and these are summed into MG_hist after the threads are joined.
+
+#define DIAG_BINS  32
+#define DIAG_MASK  (DIAG_BINS-1)
+
 static KmerPos  *MG_alist;
+static int      *MG_hist;
 
 typedef struct
   { int    abeg, aend;
     int64 *kptr;
+    int   *hist;
+    int64  ndrop;
   } Merge_Arg;
 
 static void *count_thread(void *arg)
 { Merge_Arg  *data  = (Merge_Arg *) arg;
   int64      *kptr  = data->kptr;
   KmerPos    *asort = MG_alist;
+  int        *hist  = data->hist;
   int         aend  = data->aend;
+  int64       ndrop = 0;
 
-  uint64 ca, da;
-  int    ia;
-  int    ar, nr;
-  int    ap, np;
+  uint64 ca;
+  int    ia, ib;
+  int    ja, jb, j;
+  int    ar, ap, np;
 
   ia = data->abeg;
-  da = asort[ia].code;
   while (ia < aend)
-    { ca = da;
-      ar = asort[ia].read;
-      ap = asort[ia].rpos;
-      kptr[ap & BMASK] += 1;
-      while ((da = asort[++ia].code) == ca)
-        { np = asort[ia].rpos;
-          if ((nr = asort[ia].read) == ar)
-            asort[ia].code = np - ap;
-          else
-            { asort[ia].code = 0;
-              ar = nr;
+    { ca = asort[ia].code;
+      for (ib = ia+1; ib < aend && asort[ib].code == ca; ib++)
+        ;
+
+      for (j = ia; j < ib; j++)
+        kptr[asort[j].rpos & BMASK] += 1;
+
+      if (Blockmax > 0 && ib-ia >= Blockmax)
+        { for (j = ia; j < ib; j++)
+            asort[j].code = 0;
+          ndrop += ib-ia;
+          ia = ib;
+          continue;
+        }
+
+      for (ja = ia; ja < ib; ja = jb)
+        { ar = asort[ja].read;
+          for (jb = ja+1; jb < ib && asort[jb].read == ar; jb++)
+            ;
+          asort[ja].code = 0;
+          if (Readmax > 0 && jb-ja >= Readmax)
+            { for (j = ja+1; j < jb; j++)
+                asort[j].code = 0;
+              ndrop += jb-ja;
+              continue;
+            }
+          ap = asort[ja].rpos;
+          for (j = ja+1; j < jb; j++)
+            { np = asort[j].rpos;
+              asort[j].code = np - ap;
+              hist[((int64) ar)*DIAG_BINS + (((np-ap) >> Binshift) & DIAG_MASK)] += 1;
+              ap = np;
             }
-          ap = np;
-          kptr[ap & BMASK] += 1;
         }
-      asort[ia].code = 0;
+
+      ia = ib;
     }
-            
+
+  data->ndrop = ndrop;
   return (NULL);
 }
 
@@ -852,6 +960,7 @@ typedef struct
     FILE       *ofile;
     int64       nfilt;
     int64       ncheck;
+    int64       nskip;
   } Report_Arg;
 
 static void *report_thread(void *arg)
@@ -871,6 +980,7 @@ static void *report_thread(void *arg)
   FILE        *ofile  = data->ofile;
 
   char        *aseq   = (char *) (MR_ablock->bases);
+  int          packed = (MR_ablock->loaded == DB_MAPPED);
   Work_Data   *work   = data->work;
   int          afirst = MR_ablock->tfirst;
 
@@ -879,6 +989,7 @@ static void *report_thread(void *arg)
   Path        *apath = &(ovla->path);
   int64        nfilt = 0;
   int64        ahits = 0;
+  int64        nskip = 0;
   int          small, tbytes;
 
   int    novla;
@@ -889,6 +1000,8 @@ static void *report_thread(void *arg)
 
   int      ar, aend;
   KmerPos *aoff;
+  uint8   *hitc;
+  int     *hitn;
 
   align->flags = ovla->flags = 0;
   align->path  = apath;
@@ -908,9 +1021,22 @@ static void *report_thread(void *arg)
   tbuf->max   = 2*TRACE_CHUNK;
   tbuf->trace = Malloc(sizeof(short)*tbuf->max,"Allocating trace vector");
 
-  if (amatch == NULL || tbuf->trace == NULL)
+  hitc = Malloc(sizeof(uint8)*PANEL_SIZE,"Allocating window vectors");
+  hitn = Malloc(sizeof(int)*PANEL_SIZE,"Allocating window vectors");
+
+  if (amatch == NULL || tbuf->trace == NULL || hitc == NULL || hitn == NULL)
     Clean_Exit(1);
 
+  //  If the block is packed then a read is uncompressed into a private buffer only when it
+  //    has a seed hit to check out, and then in full as an alignment from a seed in one
+  //    window can extend across the entire read
+
+  if (packed)
+    { aseq = New_Read_Buffer(MR_ablock);
+      if (aseq == NULL)
+        Clean_Exit(1);
+    }
+
   fwrite(&ahits,sizeof(int64),1,ofile);
   fwrite(&MR_tspace,sizeof(int),1,ofile);
 
@@ -920,11 +1046,10 @@ static void *report_thread(void *arg)
   fflush(stdout);
 #endif
 
-  aoff = asort + (data->beg - Kmer);
   aend = asort[data->end-1].read;
   for (ar = asort[data->beg].read; ar <= aend; ar++)
-    { int alen, amarkb, amarke;
-      int apos, diag;
+    { int alen, amarkb, amarke, wend;
+      int apos, diag, lpos, cntr;
       int setaln;
 
 #ifdef TEST_GATHER
@@ -935,29 +1060,65 @@ static void *report_thread(void *arg)
       novla  = 0;
       tbuf->top = 0;
 
+      //  A diagonal and its neighbor fall in adjacent (circular) bins of the read's histogram
+      //    and score at most Kmer per link, so if no adjacent pair of bins has Hitmin/Kmer links
+      //    there is nothing to find in the read
+
+      { int *hist = MG_hist + ((int64) ar)*DIAG_BINS;
+        int  b, s, best;
+
+        best = 0;
+        for (b = 0; b < DIAG_BINS; b++)
+          { s = hist[b] + hist[(b+1) & DIAG_MASK];
+            if (s > best)
+              best = s;
+          }
+        if (best*Kmer < Hitmin)
+          { nskip += 1;
+            continue;
+          }
+      }
+
+      aoff = asort + (TA_kbeg[ar] - Kmer);
+
+      //  The diagonal scores are for a window [amarkb,wend) of at most PANEL_SIZE positions
+      //    that slides along the read in steps of PANEL_SIZE-PANEL_OVERLAP.  At each step only
+      //    the hits of [amarke,wend) are added, the whole window (overlap zone included) is
+      //    examined against the updated scores, and then the hits that fall out of the window
+      //    are retired.  hitc records the score contribution of each hit and hitn the next hit on
+      //    the same diagonal, so that when a hit is retired its successor's contribution can be
+      //    raised to Kmer, i.e. the scores are always exactly those of the window scanned from
+      //    scratch.
+
       alen   = aread[ar].rlen;
-      amarkb = Kmer;
-      amarke = PANEL_SIZE;
-      if (amarke >= alen)
-        amarke = alen+1;
+      amarkb = amarke = Kmer;
+      wend   = PANEL_SIZE;
+      if (wend >= alen)
+        wend = alen+1;
       while (1)
         {
-          // Accumulate diagonal scores
+          // Accumulate diagonal scores of the new hits
 
-          for (apos = amarkb; apos < amarke; apos++)
+          for (apos = amarke; apos < wend; apos++)
             { diag = aoff[apos].code;
               if (diag == 0) continue;
               diag >>= Binshift;
-              if (apos - lastp[diag] >= Kmer)
-                score[diag] += Kmer;
+              lpos = lastp[diag];
+              if (apos - lpos >= Kmer)
+                cntr = Kmer;
               else
-                score[diag] += apos - lastp[diag];
+                cntr = apos - lpos;
+              score[diag] += cntr;
+              hitc[apos % PANEL_SIZE] = cntr;
+              hitn[apos % PANEL_SIZE] = 0;
+              if (lpos > 0)
+                hitn[lpos % PANEL_SIZE] = apos;
               lastp[diag] = apos;
             }
 
           // Examine diagonal scores for hits to check out
 
-          for (apos = amarkb; apos < amarke; apos++)
+          for (apos = amarkb; apos < wend; apos++)
             { diag = aoff[apos].code;
               if (diag == 0) continue;
               diag >>= Binshift;
@@ -968,7 +1129,12 @@ static void *report_thread(void *arg)
                   bpos = apos - aoff[apos].code;
                   if (setaln)
                     { setaln = 0;
-                      align->aseq = align->bseq = aseq + aread[ar].boff;
+                      if (packed)
+                        { Load_Read(MR_ablock,ar,aseq,0);
+                          align->aseq = align->bseq = aseq;
+                        }
+                      else
+                        align->aseq = align->bseq = aseq + aread[ar].boff;
                       align->alen = align->blen = alen;
                       ovla->aread = ovla->bread = ar + afirst;
                     }
@@ -1048,21 +1214,41 @@ static void *report_thread(void *arg)
                 }
             }
 
-          // Clear diagonal scores
+          if (amarke < wend)
+            amarke = wend;
+          if (amarke > alen) break;
+
+          // Slide the window, retiring the hits before its new start
+
+          lpos = wend - PANEL_OVERLAP;
+          wend = lpos + PANEL_SIZE;
+          if (wend > alen)
+            wend = alen+1;
 
-          for (apos = amarkb; apos < amarke; apos++)
+          for (apos = amarkb; apos < lpos; apos++)
             { diag = aoff[apos].code;
               if (diag == 0) continue;
               diag >>= Binshift;
-              score[diag] = lastp[diag] = 0;
+              score[diag] -= hitc[apos % PANEL_SIZE];
+              cntr = hitn[apos % PANEL_SIZE];
+              if (cntr == 0)
+                lastp[diag] = 0;
+              else
+                { score[diag] += Kmer - hitc[cntr % PANEL_SIZE];
+                  hitc[cntr % PANEL_SIZE] = Kmer;
+                }
             }
+          if (amarkb < lpos)
+            amarkb = lpos;
+        }
 
-          if (amarke > alen) break;
+      // Clear diagonal scores of the last window
 
-          amarkb = amarke - PANEL_OVERLAP;
-          amarke = amarkb + PANEL_SIZE;
-          if (amarke > alen)
-            amarke = alen+1;
+      for (apos = amarkb; apos < amarke; apos++)
+        { diag = aoff[apos].code;
+          if (diag == 0) continue;
+          diag >>= Binshift;
+          score[diag] = lastp[diag] = 0;
         }
 
       // Clear diagonal last positions
@@ -1106,15 +1292,18 @@ static void *report_thread(void *arg)
           }
         ahits += novla;
       }
-
-      aoff += alen - (Kmer-1);
     }
 
+  if (packed)
+    free(aseq-1);
+  free(hitn);
+  free(hitc);
   free(tbuf->trace);
   free(amatch);
 
   data->nfilt  = nfilt;
   data->ncheck = ahits;
+  data->nskip  = nskip;
 
   rewind(ofile);
   fwrite(&ahits,sizeof(int64),1,ofile);
@@ -1137,7 +1326,7 @@ void Match_Self(char *aname, DAZZ_DB *ablock, Align_Spec *aspec)
   Report_Arg parmr[NTHREADS];
   int        pairsort[16];
 
-  int64     nfilt, ncheck;
+  int64     nfilt, ncheck, nskip, ndrop;
 
   KmerPos  *asort, *osort;
   int       alen;
@@ -1147,7 +1336,7 @@ void Match_Self(char *aname, DAZZ_DB *ablock, Align_Spec *aspec)
 
   atot = ablock->totlen;
 
-  nfilt = ncheck = 0;
+  nfilt = ncheck = nskip = ndrop = 0;
 
   { int64 powr;
     int   i, nbyte;
@@ -1189,6 +1378,7 @@ void Match_Self(char *aname, DAZZ_DB *ablock, Align_Spec *aspec)
 
   { int    i, p;
     uint64 c;
+    int64  h, hsize;
 
     parmm[0].abeg = 0;
     for (i = 1; i < NTHREADS; i++)
@@ -1208,14 +1398,32 @@ void Match_Self(char *aname, DAZZ_DB *ablock, Align_Spec *aspec)
           parmm[i].kptr[p] = 0;
       }
 
+    hsize   = DIAG_BINS*((int64) ablock->nreads);
+    MG_hist = (int *) Malloc(sizeof(int)*hsize*NTHREADS,"Allocating diagonal histograms");
+    if (MG_hist == NULL)
+      Clean_Exit(1);
+    memset(MG_hist,0,sizeof(int)*hsize*NTHREADS);
+
     MG_alist = asort;
 
     for (i = 0; i < NTHREADS; i++)
-      pthread_create(threads+i,NULL,count_thread,parmm+i);
+      { parmm[i].hist = MG_hist + hsize*i;
+        pthread_create(threads+i,NULL,count_thread,parmm+i);
+      }
 
     for (i = 0; i < NTHREADS; i++)
       pthread_join(threads[i],NULL);
 
+    for (i = 0; i < NTHREADS; i++)
+      ndrop += parmm[i].ndrop;
+
+    for (i = 1; i < NTHREADS; i++)
+      { int *hist = parmm[i].hist;
+
+        for (h = 0; h < hsize; h++)
+          MG_hist[h] += hist[h];
+      }
+
 #ifdef TEST_PAIRS
     printf("\nCROSS SORT %d:\n",alen);
     for (i = 0; i < HOW_MANY && i <= alen; i++)
@@ -1318,11 +1526,13 @@ void Match_Self(char *aname, DAZZ_DB *ablock, Align_Spec *aspec)
       for (i = 0; i < NTHREADS; i++)
         { nfilt  += parmr[i].nfilt;
           ncheck += parmr[i].ncheck;
+          nskip  += parmr[i].nskip;
         }
 
     for (i = 0; i < NTHREADS; i++)
       Free_Work_Data(parmr[i].work);
     free(counters);
+    free(MG_hist);
   }
 
   //  Finish up
@@ -1346,6 +1556,7 @@ epilogue:
 
   free(asort);
   free(osort);
+  free(TA_kbeg);
 
   if (VERBOSE)
     { int width;
@@ -1360,7 +1571,14 @@ epilogue:
       Print_Number(nfilt,width,stdout);
       printf(" seed hits (%e of matrix)\n     ",(1.*nfilt/atot)/atot);
       Print_Number(ncheck,width,stdout);
-      printf(" confirmed hits (%e of matrix)\n",(1.*ncheck/atot)/atot);
+      printf(" confirmed hits (%e of matrix)\n     ",(1.*ncheck/atot)/atot);
+      Print_Number(nskip,width,stdout);
+      printf(" reads skipped without a possible hit\n");
+      if (Blockmax > 0 || Readmax > 0)
+        { printf("     ");
+          Print_Number(ndrop,width,stdout);
+          printf(" k-mer positions suppressed\n");
+        }
       fflush(stdout);
     }
 }
@@ -16,9 +16,12 @@
 
 extern int    VERBOSE;
 extern int    MINOVER;
+extern int    PANEL_SIZE;      //  Very long reads are scanned with a sliding window of this size
+extern int    PANEL_OVERLAP;   //    that overlaps its predecessor by this much
 extern char  *SORT_PATH;
 
-int Set_Filter_Params(int kmer, int binshift, int hitmin, int nthreads); 
+int Set_Filter_Params(int kmer, int binshift, int suppress, int rsuppress, int hitmin,
+                      int nthreads);
 
 void Match_Self(char *aname, DAZZ_DB *ablock, Align_Spec *settings);
 
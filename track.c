@@ -0,0 +1,131 @@
+/*******************************************************************************************
+ *
+ *  Buffered writer for interval (mask) tracks (see track.h)
+ *
+ *  Author:  agent
+ *  Date  :  October 2026
+ *
+ ********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "track.h"
+
+#define ANNO_BUFFER  0x80000     //  # of anno entries buffered
+#define DATA_BUFFER  0x100000    //  # of data ints buffered
+
+static void write_all(int file, void *buf, int64 len, char *name)
+{ char   *b = (char *) buf;
+  int64   n;
+
+  while (len > 0)
+    { n = write(file,b,len);
+      if (n <= 0)
+        { fprintf(stderr,"%s: Write of %s failed\n",Prog_Name,name);
+          exit (1);
+        }
+      b   += n;
+      len -= n;
+    }
+}
+
+static void flush_anno(Track_Writer *track)
+{ write_all(track->afile,track->anno,sizeof(int64)*track->atop,track->aname);
+  track->atop = 0;
+}
+
+static void flush_data(Track_Writer *track)
+{ write_all(track->dfile,track->data,sizeof(int)*track->dtop,track->dname);
+  track->dtop = 0;
+}
+
+Track_Writer *Open_Track_Writer(char *path, char *name)
+{ Track_Writer *track;
+  char         *aname, *dname;
+
+  track = (Track_Writer *) Malloc(sizeof(Track_Writer),"Allocating track writer");
+  path  = Strdup(path,"Allocating track writer");
+  if (track == NULL || path == NULL)
+    exit (1);
+  aname = track->aname = Strdup(Catenate(path,".",name,".anno"),"Allocating track writer");
+  dname = track->dname = Strdup(Catenate(path,".",name,".data"),"Allocating track writer");
+  free(path);
+  track->anno  = (int64 *) Malloc(sizeof(int64)*ANNO_BUFFER,"Allocating track writer");
+  track->data  = (int *) Malloc(sizeof(int)*DATA_BUFFER,"Allocating track writer");
+  if (track->aname == NULL || track->dname == NULL || track->anno == NULL || track->data == NULL)
+    exit (1);
+
+  track->afile = open(aname,O_WRONLY|O_CREAT|O_TRUNC,0666);
+  if (track->afile < 0)
+    { fprintf(stderr,"%s: Cannot open %s for 'w'\n",Prog_Name,aname);
+      exit (1);
+    }
+  track->dfile = open(dname,O_WRONLY|O_CREAT|O_TRUNC,0666);
+  if (track->dfile < 0)
+    { fprintf(stderr,"%s: Cannot open %s for 'w'\n",Prog_Name,dname);
+      exit (1);
+    }
+
+  //  Leave room for the header, written at close when the # of reads is known
+
+  if (lseek(track->afile,2*sizeof(int),SEEK_SET) < 0)
+    { fprintf(stderr,"%s: Cannot seek in %s\n",Prog_Name,aname);
+      exit (1);
+    }
+
+  track->nreads  = 0;
+  track->index   = 0;
+  track->anno[0] = 0;
+  track->atop    = 1;
+  track->dtop    = 0;
+  return (track);
+}
+
+void Add_Track_Read(Track_Writer *track, int *ints, int n)
+{ if (track->dtop + n > DATA_BUFFER)
+    { flush_data(track);
+      if (n > DATA_BUFFER)
+        write_all(track->dfile,ints,sizeof(int)*n,track->dname);
+    }
+  if (n <= DATA_BUFFER)
+    { memcpy(track->data+track->dtop,ints,sizeof(int)*n);
+      track->dtop += n;
+    }
+
+  if (track->atop >= ANNO_BUFFER)
+    flush_anno(track);
+  track->index += n*sizeof(int);
+  track->anno[track->atop++] = track->index;
+  track->nreads += 1;
+}
+
+void Close_Track_Writer(Track_Writer *track)
+{ int header[2];
+
+  flush_anno(track);
+  flush_data(track);
+
+  header[0] = track->nreads;
+  header[1] = 0;
+  if (pwrite(track->afile,header,2*sizeof(int),0) != 2*sizeof(int))
+    { fprintf(stderr,"%s: Write of %s failed\n",Prog_Name,track->aname);
+      exit (1);
+    }
+
+  if (fsync(track->afile) < 0 || fsync(track->dfile) < 0)
+    { fprintf(stderr,"%s: Cannot sync %s\n",Prog_Name,track->aname);
+      exit (1);
+    }
+  close(track->afile);
+  close(track->dfile);
+
+  free(track->data);
+  free(track->anno);
+  free(track->dname);
+  free(track->aname);
+  free(track);
+}
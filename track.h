@@ -0,0 +1,44 @@
+/*******************************************************************************************
+ *
+ *  Buffered writer for interval (mask) tracks.  The interval ends of each successive read
+ *    are accumulated in large buffers and the .anno and .data files are written in bulk,
+ *    the anno header being written in place when the track is closed.
+ *
+ *  Author:  agent
+ *  Date  :  October 2026
+ *
+ ********************************************************************************************/
+
+#ifndef _TRACK_WRITER
+
+#define _TRACK_WRITER
+
+#include "DB.h"
+
+typedef struct
+  { char    *aname;    //  Names of the .anno and .data files (for error messages)
+    char    *dname;
+    int      afile;    //  File descriptors of the .anno and .data files
+    int      dfile;
+    int      nreads;   //  # of reads added so far
+    int64    index;    //  Offset in the .data file of the end of the last read added
+    int      atop;     //  Buffered anno entries, anno[0..atop)
+    int64   *anno;
+    int64    dtop;     //  Buffered data, data[0..dtop) ints
+    int     *data;
+  } Track_Writer;
+
+  //  Create the files <path>.<name>.anno and <path>.<name>.data of a track, where path is
+  //    e.g. dir/.DB or dir/.DB.3 for a block track, and return a writer for them.
+
+Track_Writer *Open_Track_Writer(char *path, char *name);
+
+  //  Add the n interval ends ints[0..n) as the track data of the next read.
+
+void Add_Track_Read(Track_Writer *track, int *ints, int n);
+
+  //  Flush the buffers, write the anno header for the reads added, sync, and close the files.
+
+void Close_Track_Writer(Track_Writer *track);
+
+#endif